@@ -1,15 +1,17 @@
 /**/
 
-// Target texture
+// Post processed target presentation
 
 #include <rand.hlsli>
 
 struct present_buffer_data
 {
   uint32_t CollectionFrameCount;
+  uint32_t PostImageIndex;
+  uint32_t PresentImageIndex;
 };
 
-RWTexture2D<float4> Texture : register(u0, space0);
+RWTexture2D<float4> PostImages[2] : register(u0, space0);
 ConstantBuffer<present_buffer_data> PresentBuffer : register(b1, space0);
 
 struct vs_out
@@ -30,12 +32,21 @@ vs_out vs_main( const int VertexID : SV_VertexID )
 
 float4 ps_main( const vs_out In ) : SV_Target0
 {
-  float4 Value = Texture[(uint2)In.Position.xy].xyzw;
+  return PostImages[PresentBuffer.PresentImageIndex][(uint2)In.Position.xy];
+} /* ps_main */
+
+/* Accumulation resolve and tone mapping. Runs on compute queue over copy of target image. */
+[numthreads(8, 8, 1)]
+void cs_main( const uint3 ThreadID : SV_DispatchThreadID )
+{
+  uint Index = PresentBuffer.PostImageIndex;
+  uint2 Size;
 
-  if (PresentBuffer.CollectionFrameCount == 1)
-    Texture[(uint2)In.Position.xy].xyzw = 0;
+  PostImages[Index].GetDimensions(Size.x, Size.y);
+  if (any(ThreadID.xy >= Size))
+    return;
 
-  Value /= PresentBuffer.CollectionFrameCount;
+  float4 Value = PostImages[Index][ThreadID.xy] / PresentBuffer.CollectionFrameCount;
 
-  return Value / (Value + 1); /* TONE MAPPING JOPTIT' */
-} /* ps_main */
+  PostImages[Index][ThreadID.xy] = Value / (Value + 1); /* TONE MAPPING JOPTIT' */
+} /* cs_main */
@@ -32,7 +32,10 @@ void rrs_main( void )
   Ray.TMin = 0;
   Ray.TMax = 1024;
 
-  Target[DispatchRaysIndex().xy] += float4(Trace(Ray), 0);
+  // accumulation restarts on camera movement
+  float4 Accumulated = GlobalBuffer.IsMoved ? 0 : Target[DispatchRaysIndex().xy];
+
+  Target[DispatchRaysIndex().xy] = Accumulated + float4(Trace(Ray), 0);
 } /* rrs_main */
 
 [shader("miss")]
@@ -4,19 +4,10 @@ namespace vrt::render::core
 {
   UINT32 kernel::FindMemoryType( UINT32 TypeFilter, VkMemoryPropertyFlags PropertyFlags )
   {
-    VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties {};
-    vkGetPhysicalDeviceMemoryProperties(PhysicalDevice, &physicalDeviceMemoryProperties);
-
-    for (UINT32 i = 0; i < physicalDeviceMemoryProperties.memoryTypeCount; i++)
-    {
-      if (TypeFilter & (1 << i) && utils::CheckFlags(physicalDeviceMemoryProperties.memoryTypes[i].propertyFlags, PropertyFlags))
-        return i;
-    }
-
-    return UINT32_MAX;
+    return MemoryAllocator.FindMemoryType(TypeFilter, PropertyFlags);
   } /* findMemoryType */
 
-  buffer kernel::CreateBuffer( VkDeviceSize Size, VkBufferUsageFlags Usage, VkMemoryPropertyFlags MemoryPropertyFlags )
+  buffer kernel::CreateBuffer( VkDeviceSize Size, VkBufferUsageFlags Usage, VkMemoryPropertyFlags MemoryPropertyFlags, VkMemoryPropertyFlags PreferredMemoryPropertyFlags )
   {
     buffer Buffer {this};
 
@@ -29,47 +20,20 @@ namespace vrt::render::core
       .flags = 0,
       .size = Size,
       .usage = Usage,
+      // buffers are passed between queue families by ownership transfers
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+      .queueFamilyIndexCount = 0,
+      .pQueueFamilyIndices = nullptr,
     };
 
-    if (QueueFamilies.Unique.size() == 1)
-    {
-      CreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-      CreateInfo.queueFamilyIndexCount = 0;
-      CreateInfo.pQueueFamilyIndices = nullptr;
-    }
-    else
-    {
-      CreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
-      CreateInfo.queueFamilyIndexCount = static_cast<UINT32>(QueueFamilies.Unique.size());
-      CreateInfo.pQueueFamilyIndices = QueueFamilies.Unique.data();
-    }
-
     utils::AssertResult(vkCreateBuffer(Device, &CreateInfo, nullptr, &Buffer.Buffer), "error creating buffer");
 
     VkMemoryRequirements MemoryRequirements;
     vkGetBufferMemoryRequirements(Device, Buffer.Buffer, &MemoryRequirements);
-    Buffer.MemoryTypeIndex = FindMemoryType(MemoryRequirements.memoryTypeBits, MemoryPropertyFlags);
-
-    // VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT 
-    VkMemoryAllocateFlagsInfo AllocateFlagsInfo
-    {
-      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO,
-      .pNext = nullptr,
-      .flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT,
-      .deviceMask = 0,
-    };
-
-    VkMemoryAllocateInfo AllocateInfo
-    {
-      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-      .pNext = &AllocateFlagsInfo,
-      .allocationSize = MemoryRequirements.size,
-      .memoryTypeIndex = Buffer.MemoryTypeIndex,
-    };
-
-    utils::AssertResult(vkAllocateMemory(Device, &AllocateInfo, nullptr, &Buffer.Memory), "error allocating memory");
+    Buffer.Allocation = MemoryAllocator.Allocate(MemoryRequirements, MemoryPropertyFlags, PreferredMemoryPropertyFlags, FALSE);
+    Buffer.MemoryTypeIndex = Buffer.Allocation.Block->MemoryTypeIndex;
 
-    vkBindBufferMemory(Device, Buffer.Buffer, Buffer.Memory, 0);
+    utils::AssertResult(vkBindBufferMemory(Device, Buffer.Buffer, Buffer.Allocation.Memory, Buffer.Allocation.Offset), "error binding buffer memory");
 
     return std::move(Buffer);
   } /* CreateBuffer */
@@ -88,7 +52,7 @@ namespace vrt::render::core
   {
     std::swap(Kernel, Other.Kernel);
     std::swap(Buffer, Other.Buffer);
-    std::swap(Memory, Other.Memory);
+    std::swap(Allocation, Other.Allocation);
     std::swap(Size, Other.Size);
     std::swap(MemoryTypeIndex, Other.MemoryTypeIndex);
 
@@ -107,42 +71,44 @@ namespace vrt::render::core
     return vkGetBufferDeviceAddress(Kernel->Device, &DeviceAddressInfo);
   } /* GetDeviceAddress */
 
-  VOID buffer::CopyTo( buffer &DestinationBuffer )
+  upload_ticket buffer::CopyTo( buffer &DestinationBuffer )
   {
     VkCommandBuffer CommandBuffer = Kernel->BeginTransfer();
     VkBufferCopy Copy { 0, 0, std::min(Size, DestinationBuffer.Size) };
     vkCmdCopyBuffer(CommandBuffer, Buffer, DestinationBuffer.Buffer, 1, &Copy);
-    Kernel->EndTransfer(CommandBuffer);
+    Kernel->ReleaseToGraphics(CommandBuffer, DestinationBuffer.Buffer, 0, Copy.size);
+    return Kernel->EndTransfer(CommandBuffer);
   } /* CopyTo */
 
 
-  VOID buffer::WriteData( const VOID *Data, SIZE_T DataSize )
+  upload_ticket buffer::WriteData( const VOID *Data, SIZE_T DataSize, VkDeviceSize Offset )
   {
-    buffer StagingBuffer = Kernel->CreateBuffer(DataSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    std::memcpy(StagingBuffer.MapMemory(), Data, DataSize);
-    StagingBuffer.UnmapMemory();
+    if (Kernel->UploadBatch.IsActive())
+    {
+      Kernel->UploadBatch.WriteBuffer(*this, Offset, Data, DataSize);
+      return upload_ticket {};
+    }
 
-    StagingBuffer.CopyTo(*this);
-    Kernel->Destroy(StagingBuffer);
+    return Kernel->StagingRing.Upload(*this, Offset, Data, DataSize);
   } /* WriteData */
 
 
   VOID * buffer::MapMemory( VOID )
   {
-    VOID *MemoryMap = nullptr;
-    vkMapMemory(Kernel->Device, Memory, 0, Size, 0, &MemoryMap);
-    return MemoryMap;
+    // blocks of host-visible memory are mapped by allocator once, several buffers share one mapping
+    return Allocation.MappedData;
   } /* MapMemory */
 
   VOID buffer::UnmapMemory( VOID )
   {
-    vkUnmapMemory(Kernel->Device, Memory);
+    // nothing to do, memory stays mapped until block is freed
   } /* UnmapMemory */
 
   VOID kernel::Destroy( buffer &Buffer )
   {
-    vkFreeMemory(Device, Buffer.Memory, nullptr);
+    DiscardAcquires(Buffer.Buffer);
     vkDestroyBuffer(Device, Buffer.Buffer, nullptr);
+    MemoryAllocator.Free(Buffer.Allocation);
+    Buffer.Buffer = VK_NULL_HANDLE;
   } /* buffer */
 } /* namespace vrt::render */
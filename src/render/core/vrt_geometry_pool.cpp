@@ -0,0 +1,111 @@
+#include "vrt.h"
+
+namespace vrt::render::core
+{
+  VOID geometry_pool::Initialize( kernel *NewKernel, VkDeviceSize NewPageSize )
+  {
+    Kernel = NewKernel;
+    PageSize = NewPageSize;
+  } /* Initialize */
+
+  UINT32 geometry_pool::CreatePage( VkDeviceSize Size )
+  {
+    page *Page = new page;
+
+    Page->Buffer = Kernel->CreateBuffer(Size,
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    Page->Address = Page->Buffer.GetDeviceAddress();
+    Page->Ranges.Initialize(Size);
+
+    // reuse index of destroyed page, so ranges of other pages stay valid
+    for (UINT32 i = 0; i < Pages.size(); i++)
+      if (Pages[i] == nullptr)
+      {
+        Pages[i] = Page;
+        return i;
+      }
+
+    Pages.push_back(Page);
+    return static_cast<UINT32>(Pages.size() - 1);
+  } /* CreatePage */
+
+  VOID geometry_pool::DestroyPage( UINT32 Index )
+  {
+    Kernel->Destroy(Pages[Index]->Buffer);
+    delete Pages[Index];
+    Pages[Index] = nullptr;
+  } /* DestroyPage */
+
+  geometry_range geometry_pool::Allocate( VkDeviceSize Size )
+  {
+    geometry_range Range {};
+
+    Range.Size = utils::Align(std::max<VkDeviceSize>(Size, 1), RangeAlignment);
+
+    for (UINT32 i = 0; i < Pages.size(); i++)
+    {
+      if (Pages[i] == nullptr || Pages[i]->Ranges.GetLargestFreeRange() < Range.Size)
+        continue;
+
+      Range.Offset = Pages[i]->Ranges.Allocate(Range.Size, RangeAlignment);
+      if (Range.Offset != range_allocator::InvalidOffset)
+      {
+        Range.Page = i;
+        break;
+      }
+    }
+
+    // no space in existing pages - create new one (large geometry gets page of its own size)
+    if (Range.Page == UINT32_MAX)
+    {
+      Range.Page = CreatePage(std::max(PageSize, Range.Size));
+      Range.Offset = Pages[Range.Page]->Ranges.Allocate(Range.Size, RangeAlignment);
+    }
+
+    Pages[Range.Page]->RangeCount++;
+
+    return Range;
+  } /* Allocate */
+
+  VOID geometry_pool::Free( geometry_range &Range )
+  {
+    if (Range.Page == UINT32_MAX)
+      return;
+
+    page *Page = Pages[Range.Page];
+
+    Page->Ranges.Free(Range.Offset, Range.Size);
+    Page->RangeCount--;
+
+    // keep one empty page to avoid buffer recreation on scene reload
+    if (Page->RangeCount == 0)
+      for (UINT32 i = 0; i < Pages.size(); i++)
+        if (i != Range.Page && Pages[i] != nullptr && Pages[i]->RangeCount == 0)
+        {
+          DestroyPage(Range.Page);
+          break;
+        }
+
+    Range = geometry_range {};
+  } /* Free */
+
+  buffer & geometry_pool::GetBuffer( const geometry_range &Range )
+  {
+    return Pages[Range.Page]->Buffer;
+  } /* GetBuffer */
+
+  VkDeviceAddress geometry_pool::GetAddress( const geometry_range &Range ) const
+  {
+    return Pages[Range.Page]->Address + Range.Offset;
+  } /* GetAddress */
+
+  VOID geometry_pool::Close( VOID )
+  {
+    for (UINT32 i = 0; i < Pages.size(); i++)
+      if (Pages[i] != nullptr)
+        DestroyPage(i);
+
+    Pages.clear();
+  } /* Close */
+} /* namespace vrt::render::core */
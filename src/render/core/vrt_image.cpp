@@ -17,26 +17,13 @@ namespace vrt::render::core
       /* VkSampleCountFlagBits */ .samples = VK_SAMPLE_COUNT_1_BIT,
       /* VkImageTiling         */ .tiling = Tiling,
       /* VkImageUsageFlags     */ .usage = UsageFlags,
-      /* VkSharingMode         */ // .sharingMode = VK_SHARING_MODE_CONCURRENT,
-      /* uint32_t              */ // .queueFamilyIndexCount = static_cast<UINT32>(std::size(QueueFamilies)),
-      /* const uint32_t*       */ // .pQueueFamilyIndices = QueueFamilies,
+      /* VkSharingMode         */ .sharingMode = VK_SHARING_MODE_EXCLUSIVE, // images are passed between queue families by ownership transfers
+      /* uint32_t              */ .queueFamilyIndexCount = 0,
+      /* const uint32_t*       */ .pQueueFamilyIndices = nullptr,
       /* VkImageLayout         */ .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
     };
 
-    if (QueueFamilies.Unique.size() != 1)
-    {
-      CreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
-      CreateInfo.queueFamilyIndexCount = static_cast<UINT32>(QueueFamilies.Unique.size());
-      CreateInfo.pQueueFamilyIndices = QueueFamilies.Unique.data();
-    }
-    else
-    {
-      CreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-      CreateInfo.queueFamilyIndexCount = 0;
-      CreateInfo.pQueueFamilyIndices = nullptr;
-    }
-
-    image Image;
+    image Image {this};
 
     Image.Format = Format;
     Image.Width = Width;
@@ -46,26 +33,18 @@ namespace vrt::render::core
     VkMemoryRequirements MemoryRequirements;
     vkGetImageMemoryRequirements(Device, Image.Image, &MemoryRequirements);
 
-    VkMemoryAllocateInfo AllocInfo
-    {
-      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-      .pNext = nullptr,
-      .allocationSize = MemoryRequirements.size,
-      .memoryTypeIndex = FindMemoryType(MemoryRequirements.memoryTypeBits, MemoryProperties),
-    };
+    Image.Allocation = MemoryAllocator.Allocate(MemoryRequirements, MemoryProperties, 0, Tiling == VK_IMAGE_TILING_OPTIMAL);
+    Image.MemoryTypeIndex = Image.Allocation.Block->MemoryTypeIndex;
 
-    utils::AssertResult(vkAllocateMemory(Device, &AllocInfo, nullptr, &Image.Memory));
+    utils::AssertResult(vkBindImageMemory(Device, Image.Image, Image.Allocation.Memory, Image.Allocation.Offset), "error binding image memory");
 
-    vkBindImageMemory(Device, Image.Image, Image.Memory, 0);
-
-    Image.MemoryTypeIndex = AllocInfo.memoryTypeIndex;
     Image.ImageView = CreateImageView(Image.Image, Image.Format);
 
     return Image;
   } /* CreateImage */
 
 
-  VOID kernel::TransferImageLayout( image &Image, VkImageLayout OldLayout, VkImageLayout NewLayout )
+  upload_ticket kernel::TransferImageLayout( image &Image, VkImageLayout OldLayout, VkImageLayout NewLayout )
   {
     VkCommandBuffer TransferCommandBuffer = BeginTransfer();
 
@@ -128,16 +107,20 @@ namespace vrt::render::core
     if (NewLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
       ImageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
 
-    vkCmdPipelineBarrier
-    (
-      TransferCommandBuffer,
-      SourceStageFlags, DestinationStageFlags, 0,
-      0, nullptr,
-      0, nullptr,
-      1, &ImageMemoryBarrier
-    );
+    // image is used by graphics queue after transition, unless it is prepared for transfer commands
+    if (NewLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+      vkCmdPipelineBarrier
+      (
+        TransferCommandBuffer,
+        SourceStageFlags, DestinationStageFlags, 0,
+        0, nullptr,
+        0, nullptr,
+        1, &ImageMemoryBarrier
+      );
+    else
+      ReleaseToGraphics(TransferCommandBuffer, ImageMemoryBarrier, SourceStageFlags);
 
-    EndTransfer(TransferCommandBuffer);
+    return EndTransfer(TransferCommandBuffer);
   } /* TransferImageLayout */
 
   VkImageView kernel::CreateImageView( VkImage Image, VkFormat ImageFormat )
@@ -180,7 +163,7 @@ namespace vrt::render::core
   {
     std::swap(Kernel, Other.Kernel);
     std::swap(Image, Other.Image);
-    std::swap(Memory, Other.Memory);
+    std::swap(Allocation, Other.Allocation);
     std::swap(Format, Other.Format);
     std::swap(ImageView, Other.ImageView);
     std::swap(MemoryTypeIndex, Other.MemoryTypeIndex);
@@ -192,8 +175,11 @@ namespace vrt::render::core
 
   VOID kernel::Destroy( image &Image )
   {
+    DiscardAcquires(Image.Image);
     vkDestroyImageView(Device, Image.ImageView, nullptr);
     vkDestroyImage(Device, Image.Image, nullptr);
-    vkFreeMemory(Device, Image.Memory, nullptr);
+    MemoryAllocator.Free(Image.Allocation);
+    Image.Image = VK_NULL_HANDLE;
+    Image.ImageView = VK_NULL_HANDLE;
   } /* Destroy */
 } /* vrt::render */
\ No newline at end of file
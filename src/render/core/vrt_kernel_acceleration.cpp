@@ -0,0 +1,661 @@
+#include "vrt.h"
+
+namespace vrt::render::core
+{
+  std::vector<VkAccelerationStructureGeometryKHR> kernel::GetModelGeometries( const model *Model, std::vector<VkAccelerationStructureBuildRangeInfoKHR> &RangeInfos )
+  {
+    std::vector<VkAccelerationStructureGeometryKHR> Geometries {Model->Primitives.size()};
+    RangeInfos.resize(Model->Primitives.size());
+
+    for (SIZE_T i = 0; i < Geometries.size(); i++)
+    {
+      const primitive *Primitive = Model->Primitives[i];
+
+      Geometries[i] = VkAccelerationStructureGeometryKHR
+      {
+        /* VkStructureType                        */ .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
+        /* const void*                            */ .pNext = nullptr,
+        /* VkGeometryTypeKHR                      */ .geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR,
+        /* VkAccelerationStructureGeometryDataKHR */ .geometry = {},
+        /* VkGeometryFlagsKHR                     */ .flags = VK_GEOMETRY_OPAQUE_BIT_KHR,
+      };
+
+      VkAccelerationStructureGeometryTrianglesDataKHR &TrianglesData = Geometries[i].geometry.triangles;
+      TrianglesData = VkAccelerationStructureGeometryTrianglesDataKHR
+      {
+        /* VkStructureType               */ .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR,
+        /* const void*                   */ .pNext = nullptr,
+        /* VkFormat                      */ .vertexFormat = VK_FORMAT_R32G32B32_SFLOAT,
+        /* VkDeviceOrHostAddressConstKHR */ .vertexData = { .deviceAddress = Primitive->GetVertexAddress() + Primitive->VertexPositionComponentOffset },
+        /* VkDeviceSize                  */ .vertexStride = Primitive->VertexSize,
+        /* uint32_t                      */ .maxVertex = (UINT32)Primitive->VertexCount,
+        /* VkIndexType                   */ .indexType = Primitive->IndexCount != 0 ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_NONE_KHR,
+        /* VkDeviceOrHostAddressConstKHR */ .indexData = { .deviceAddress = Primitive->GetIndexAddress() },
+        /* VkDeviceOrHostAddressConstKHR */ .transformData {},
+      };
+
+      RangeInfos[i] = VkAccelerationStructureBuildRangeInfoKHR
+      {
+        .primitiveCount = (UINT32)std::max<SIZE_T>(Primitive->VertexCount, Primitive->IndexCount) / 3,
+        .primitiveOffset = 0,
+        .firstVertex = 0,
+        .transformOffset = 0,
+      };
+    }
+
+    return Geometries;
+  } /* GetModelGeometries */
+
+  VOID scratch_arena::Initialize( kernel *NewKernel )
+  {
+    Kernel = NewKernel;
+    Alignment = std::max<VkDeviceSize>(Kernel->PhysicalDeviceProperties.AccelerationStructureProperties.minAccelerationStructureScratchOffsetAlignment, 1);
+  } /* Initialize */
+
+  VkDeviceSize scratch_arena::Pack( std::span<const VkDeviceSize> Sizes, std::span<VkDeviceAddress> Addresses ) const
+  {
+    VkDeviceSize Size = 0;
+    for (SIZE_T i = 0; i < Sizes.size(); i++)
+    {
+      Addresses[i] = Size;
+      Size = utils::Align(Size + Sizes[i], Alignment);
+    }
+    return Size;
+  } /* Pack */
+
+  VOID scratch_arena::Allocate( VkCommandBuffer CommandBuffer, std::span<const VkDeviceSize> Sizes, std::span<VkDeviceAddress> Addresses )
+  {
+    VkDeviceSize Size = Pack(Sizes, Addresses);
+
+    // storage grows to high-water mark - frames in flight and earlier batches of this frame may still use old one, so it is kept until frame submission
+    if (Size > Capacity)
+    {
+      if (Buffer.Buffer != VK_NULL_HANDLE)
+        ReplacedBuffers.push_back(std::move(Buffer));
+
+      Capacity = utils::Align(Size, GrowthGranularity);
+
+      // buffer address isn't guaranteed to be aligned for scratch - reserve space to align it
+      Buffer = Kernel->CreateBuffer(Capacity + Alignment, VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+      Address = utils::Align(Buffer.GetDeviceAddress(), Alignment);
+    }
+
+    for (VkDeviceAddress &RangeAddress : Addresses)
+      RangeAddress += Address;
+
+    // previous builds, which used same ranges, are finished before batch builds
+    VkMemoryBarrier ScratchBarrier
+    {
+      /* VkStructureType */ .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      /* const void*     */ .pNext = nullptr,
+      /* VkAccessFlags   */ .srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+      /* VkAccessFlags   */ .dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+    };
+    vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1, &ScratchBarrier, 0, nullptr, 0, nullptr);
+  } /* Allocate */
+
+  buffer scratch_arena::CreateStandalone( std::span<const VkDeviceSize> Sizes, std::span<VkDeviceAddress> Addresses ) const
+  {
+    VkDeviceSize Size = Pack(Sizes, Addresses);
+
+    // buffer address isn't guaranteed to be aligned for scratch - reserve space to align it
+    buffer Standalone = Kernel->CreateBuffer(Size + Alignment, VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    VkDeviceAddress StandaloneAddress = utils::Align(Standalone.GetDeviceAddress(), Alignment);
+
+    for (VkDeviceAddress &RangeAddress : Addresses)
+      RangeAddress += StandaloneAddress;
+    return Standalone;
+  } /* CreateStandalone */
+
+  VOID scratch_arena::RetireReplaced( VOID )
+  {
+    for (buffer &Replaced : ReplacedBuffers)
+      Kernel->Retire(Replaced);
+    ReplacedBuffers.clear();
+  } /* RetireReplaced */
+
+  VOID scratch_arena::Close( VOID )
+  {
+    for (buffer &Replaced : ReplacedBuffers)
+      Kernel->Destroy(Replaced);
+    ReplacedBuffers.clear();
+    if (Buffer.Buffer != VK_NULL_HANDLE)
+      Kernel->Destroy(Buffer);
+    Capacity = 0;
+    Address = 0;
+  } /* Close */
+
+  VOID kernel::WriteSceneInstances( scene *Scene, UINT32 Region )
+  {
+    // instances of model share its BLAS and hit groups - every model primitive has its own hit group
+    UINT32 Offset = 0;
+    Scene->ModelInstances.resize(Scene->Models.size());
+    Scene->ModelTransformGenerations.resize(Scene->Models.size());
+    Scene->ModelBLASGenerations.resize(Scene->Models.size());
+    for (SIZE_T m = 0; m < Scene->Models.size(); m++)
+    {
+      model *Model = Scene->Models[m];
+
+      VkAccelerationStructureDeviceAddressInfoKHR DeviceAddressInfo
+      {
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR,
+        .pNext = nullptr,
+        .accelerationStructure = Model->BLAS,
+      };
+
+      Scene->ModelInstances[m] = VkAccelerationStructureInstanceKHR
+      {
+        .transform = Model->TransformMatrix,
+        .instanceCustomIndex = 0,
+        .mask = 0xFF,
+        .instanceShaderBindingTableRecordOffset = Offset,
+        .flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR,
+        .accelerationStructureReference = vkGetAccelerationStructureDeviceAddressKHR(Device, &DeviceAddressInfo),
+      };
+      Offset += (UINT32)Model->Primitives.size();
+      Scene->ModelTransformGenerations[m] = Model->TransformGeneration;
+      Scene->ModelBLASGenerations[m] = Model->BLASGeneration;
+    }
+
+    Scene->InstanceData.resize(Scene->InstanceCount);
+    for (SIZE_T i = 0; i < Scene->InstanceCount; i++)
+    {
+      const instance &Instance = Scene->Instances[i];
+      VkAccelerationStructureInstanceKHR &Data = Scene->InstanceData[i];
+
+      Data = Scene->ModelInstances[Instance.ModelIndex];
+      Data.transform = Instance.Model->TransformMatrix * Instance.TransformMatrix;
+      Data.instanceCustomIndex = Instance.CustomIndex;
+      Data.mask = Instance.Mask;
+    }
+    Scene->IsInstancesChanged = FALSE;
+
+    // instance buffer memory is write-combined, so instances are written by one sequential copy
+    BYTE *Data = reinterpret_cast<BYTE *>(Scene->InstanceBuffer.MapMemory());
+    std::memcpy(Data + Region * Scene->InstanceCount * sizeof(VkAccelerationStructureInstanceKHR), Scene->InstanceData.data(), Scene->InstanceCount * sizeof(VkAccelerationStructureInstanceKHR));
+    Scene->InstanceBuffer.UnmapMemory();
+  } /* WriteSceneInstances */
+
+  VkAccelerationStructureGeometryKHR kernel::GetSceneGeometry( const scene *Scene, UINT32 Region )
+  {
+    VkAccelerationStructureGeometryInstancesDataKHR InstancesVk
+    {
+      .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR,
+      .pNext = nullptr,
+      .arrayOfPointers = VK_FALSE,
+      .data = { .deviceAddress = Scene->InstanceBuffer.GetDeviceAddress() + Region * Scene->InstanceCount * sizeof(VkAccelerationStructureInstanceKHR) },
+    };
+
+    return VkAccelerationStructureGeometryKHR
+    {
+      .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
+      .pNext = nullptr,
+      .geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR,
+      .geometry = { .instances = InstancesVk },
+      .flags = 0,
+    };
+  } /* GetSceneGeometry */
+
+  BOOL kernel::IsSceneUpdateRequired( const scene *Scene ) const
+  {
+    if (!PendingVertexWrites.empty() || Scene->IsInstancesChanged)
+      return TRUE;
+
+    for (SIZE_T m = 0; m < Scene->Models.size(); m++)
+    {
+      const model *Model = Scene->Models[m];
+
+      // BLAS may be refitted by other scene, which shares model
+      if (Model->TransformGeneration != Scene->ModelTransformGenerations[m] || Model->BLASGeneration != Scene->ModelBLASGenerations[m] || Model->IsGeometryChanged())
+        return TRUE;
+    }
+    return FALSE;
+  } /* IsSceneUpdateRequired */
+
+  VOID kernel::WritePrimitiveVertices( primitive *Primitive, const VOID *Vertices, SIZE_T Size )
+  {
+    // static BLASes are compacted and can't be refitted
+    utils::Assert(!Primitive->IsStatic, "geometry of static model can't be changed");
+    utils::Assert(Size <= StagingRing.GetCapacity(), "vertex write is too large for staging ring");
+
+    // data is staged by frame, which copies it, so ring space isn't held by not recorded writes
+    const BYTE *Data = reinterpret_cast<const BYTE *>(Vertices);
+
+    Primitive->Grab();
+    PendingVertexWrites.push_back(vertex_write
+    {
+      .Primitive = Primitive,
+      .Data = {Data, Data + Size},
+    });
+  } /* WritePrimitiveVertices */
+
+  VOID kernel::RecordModelRefits( scene *Scene, VkCommandBuffer CommandBuffer )
+  {
+    /* Refit data of one model */
+    struct model_refit
+    {
+      std::vector<VkAccelerationStructureGeometryKHR> Geometries;
+      std::vector<VkAccelerationStructureBuildRangeInfoKHR> RangeInfos;
+    }; /* model_refit */
+
+    std::vector<model *> Models;
+    for (model *Model : Scene->Models)
+      if (Model->IsGeometryChanged())
+        Models.push_back(Model);
+
+    if (Models.empty())
+      return;
+
+    std::vector<model_refit> Refits {Models.size()};
+    std::vector<VkAccelerationStructureBuildGeometryInfoKHR> BuildInfos {Models.size()};
+    std::vector<const VkAccelerationStructureBuildRangeInfoKHR *> RangeInfoPointers {Models.size()};
+    std::vector<VkDeviceSize> ScratchSizes(Models.size());
+    std::vector<VkDeviceAddress> ScratchAddresses(Models.size());
+
+    for (SIZE_T m = 0; m < Models.size(); m++)
+    {
+      model *Model = Models[m];
+      model_refit &Refit = Refits[m];
+
+      Refit.Geometries = GetModelGeometries(Model, Refit.RangeInfos);
+      RangeInfoPointers[m] = Refit.RangeInfos.data();
+
+      // refit keeps tree topology - it degrades with deformation, so tree is rebuilt from time to time
+      FLOAT BoundsArea = Model->GetBoundsArea();
+      BOOL DoRebuild = Model->RefitCount >= BLASRefitLimit || BoundsArea > Model->BuildBoundsArea * BLASBoundsGrowthLimit;
+
+      if (DoRebuild)
+      {
+        Model->RefitCount = 0;
+        Model->BuildBoundsArea = BoundsArea;
+      }
+      else
+        Model->RefitCount++;
+      ScratchSizes[m] = DoRebuild ? Model->BuildScratchSize : Model->UpdateScratchSize;
+
+      BuildInfos[m] = VkAccelerationStructureBuildGeometryInfoKHR
+      {
+        /* VkStructureType                                  */ .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
+        /* const void*                                      */ .pNext = nullptr,
+        /* VkAccelerationStructureTypeKHR                   */ .type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+        /* VkBuildAccelerationStructureFlagsKHR             */ .flags = GetModelBuildFlags(Model),
+        /* VkBuildAccelerationStructureModeKHR              */ .mode = DoRebuild ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR : VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR,
+        /* VkAccelerationStructureKHR                       */ .srcAccelerationStructure = DoRebuild ? VK_NULL_HANDLE : Model->BLAS,
+        /* VkAccelerationStructureKHR                       */ .dstAccelerationStructure = Model->BLAS,
+        /* uint32_t                                         */ .geometryCount = (UINT32)Refit.Geometries.size(),
+        /* const VkAccelerationStructureGeometryKHR*        */ .pGeometries = Refit.Geometries.data(),
+        /* const VkAccelerationStructureGeometryKHR* const* */ .ppGeometries = nullptr,
+        /* VkDeviceOrHostAddressKHR                         */ .scratchData = {},
+      };
+    }
+
+    // every model has its own scratch range, so all refits are done by one command
+    ScratchArena.Allocate(CommandBuffer, ScratchSizes, ScratchAddresses);
+    for (SIZE_T m = 0; m < Models.size(); m++)
+      BuildInfos[m].scratchData.deviceAddress = ScratchAddresses[m];
+    vkCmdBuildAccelerationStructuresKHR(CommandBuffer, (UINT32)BuildInfos.size(), BuildInfos.data(), RangeInfoPointers.data());
+
+    // primitives may be shared with other models, so built generations are kept by every model
+    for (model *Model : Models)
+    {
+      for (SIZE_T i = 0; i < Model->Primitives.size(); i++)
+        Model->BuiltGeometryGenerations[i] = Model->Primitives[i]->GeometryGeneration;
+      Model->BLASGeneration++;
+    }
+
+    // TLAS build reads refitted BLASes
+    VkMemoryBarrier RefitBarrier
+    {
+      /* VkStructureType */ .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      /* const void*     */ .pNext = nullptr,
+      /* VkAccessFlags   */ .srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+      /* VkAccessFlags   */ .dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR,
+    };
+    vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1, &RefitBarrier, 0, nullptr, 0, nullptr);
+  } /* RecordModelRefits */
+
+  VOID kernel::RecordSceneUpdate( scene *Scene, VkCommandBuffer CommandBuffer, UINT32 FrameSlot )
+  {
+    // previous frames raytracing and builds are finished before vertices, acceleration structures and scratch are rewritten
+    VkMemoryBarrier UpdateBarrier
+    {
+      /* VkStructureType */ .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      /* const void*     */ .pNext = nullptr,
+      /* VkAccessFlags   */ .srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+      /* VkAccessFlags   */ .dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR | VK_ACCESS_TRANSFER_WRITE_BIT,
+    };
+    VkPipelineStageFlags UpdateSrcStages = VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
+    VkPipelineStageFlags UpdateDstStages = VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR | VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+    // vertices written by shaders of earlier graphics queue submissions are read by builds and hit shaders
+    if (IsDeviceGeometryWritten)
+    {
+      UpdateBarrier.srcAccessMask |= VK_ACCESS_SHADER_WRITE_BIT;
+      UpdateBarrier.dstAccessMask |= VK_ACCESS_SHADER_READ_BIT;
+      UpdateSrcStages |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+      UpdateDstStages |= VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR;
+      IsDeviceGeometryWritten = FALSE;
+    }
+    vkCmdPipelineBarrier(CommandBuffer, UpdateSrcStages, UpdateDstStages, 0, 1, &UpdateBarrier, 0, nullptr, 0, nullptr);
+
+    // vertices are copied on graphics queue, so frames in flight never see partially written ones
+    if (!PendingVertexWrites.empty())
+    {
+      // staged data is committed after frame submission, so ring space is released when frame copies are finished
+      SIZE_T RecordedCount = 0;
+      for (; RecordedCount < PendingVertexWrites.size(); RecordedCount++)
+      {
+        vertex_write &Write = PendingVertexWrites[RecordedCount];
+        primitive *Primitive = Write.Primitive;
+        BOOL IsPooled = Primitive->VertexRange.Page != UINT32_MAX;
+
+        // ring is full of data copied by this frame - rest of writes is recorded by next one
+        VkDeviceSize StagingOffset = StagingRing.Stage(Write.Data.data(), Write.Data.size());
+        if (StagingOffset == staging_ring::InvalidOffset)
+          break;
+
+        VkBufferCopy Region
+        {
+          /* VkDeviceSize */ .srcOffset = StagingOffset,
+          /* VkDeviceSize */ .dstOffset = IsPooled ? Primitive->VertexRange.Offset : 0,
+          /* VkDeviceSize */ .size = Write.Data.size(),
+        };
+        vkCmdCopyBuffer(CommandBuffer, StagingRing.GetBuffer(), IsPooled ? GeometryPool.GetBuffer(Primitive->VertexRange).Buffer : Primitive->VertexBuffer.Buffer, 1, &Region);
+
+        // bounds of new vertices decide between refit and rebuild
+        Primitive->EvaluateBounds(Write.Data.data());
+        Primitive->GeometryGeneration++;
+        Primitive->Release();
+      }
+      PendingVertexWrites.erase(PendingVertexWrites.begin(), PendingVertexWrites.begin() + RecordedCount);
+
+      // builds and hit shaders read new vertices
+      VkMemoryBarrier CopyBarrier
+      {
+        /* VkStructureType */ .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        /* const void*     */ .pNext = nullptr,
+        /* VkAccessFlags   */ .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        /* VkAccessFlags   */ .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+      };
+      vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR | VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, 0, 1, &CopyBarrier, 0, nullptr, 0, nullptr);
+    }
+
+    RecordModelRefits(Scene, CommandBuffer);
+
+    // frame data fence is waited, so its instances region isn't read by device
+    WriteSceneInstances(Scene, FrameSlot);
+
+    // refitted TLAS quality degrades with every update - rebuild it periodically
+    BOOL DoRebuild = ++Scene->TLASUpdateCount > TLASRebuildPeriod;
+    if (DoRebuild)
+      Scene->TLASUpdateCount = 0;
+
+    VkAccelerationStructureGeometryKHR Geometry = GetSceneGeometry(Scene, FrameSlot);
+
+    VkAccelerationStructureBuildGeometryInfoKHR BuildGeometryInfo
+    {
+      /* VkStructureType                                  */ .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
+      /* const void*                                      */ .pNext = nullptr,
+      /* VkAccelerationStructureTypeKHR                   */ .type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR,
+      /* VkBuildAccelerationStructureFlagsKHR             */ .flags = VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR,
+      /* VkBuildAccelerationStructureModeKHR              */ .mode = DoRebuild ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR : VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR,
+      /* VkAccelerationStructureKHR                       */ .srcAccelerationStructure = DoRebuild ? VK_NULL_HANDLE : Scene->TLAS,
+      /* VkAccelerationStructureKHR                       */ .dstAccelerationStructure = Scene->TLAS,
+      /* uint32_t                                         */ .geometryCount = 1,
+      /* const VkAccelerationStructureGeometryKHR*        */ .pGeometries = &Geometry,
+      /* const VkAccelerationStructureGeometryKHR* const* */ .ppGeometries = nullptr,
+      /* VkDeviceOrHostAddressKHR                         */ .scratchData = {},
+    };
+
+    // arena orders this build after refits, which used same scratch
+    VkDeviceSize ScratchSize = DoRebuild ? Scene->TLASBuildScratchSize : Scene->TLASUpdateScratchSize;
+    ScratchArena.Allocate(CommandBuffer, {&ScratchSize, 1}, {&BuildGeometryInfo.scratchData.deviceAddress, 1});
+
+    VkAccelerationStructureBuildRangeInfoKHR RangeInfo
+    {
+      .primitiveCount = UINT32(Scene->InstanceCount),
+      .primitiveOffset = 0,
+      .firstVertex = 0,
+      .transformOffset = 0,
+    };
+
+    VkAccelerationStructureBuildRangeInfoKHR *PtrRangeInfo = &RangeInfo;
+    vkCmdBuildAccelerationStructuresKHR(CommandBuffer, 1, &BuildGeometryInfo, &PtrRangeInfo);
+
+    // frame raytracing reads updated TLAS
+    VkMemoryBarrier TraceBarrier
+    {
+      /* VkStructureType */ .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      /* const void*     */ .pNext = nullptr,
+      /* VkAccessFlags   */ .srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+      /* VkAccessFlags   */ .dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR,
+    };
+    vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, 0, 1, &TraceBarrier, 0, nullptr, 0, nullptr);
+  } /* RecordSceneUpdate */
+
+  VOID kernel::AddGeometryWrite( VkSemaphore WriteTimeline, UINT64 WriteValue )
+  {
+    std::lock_guard<std::recursive_mutex> Lock(SubmitMutex);
+
+    IsDeviceGeometryWritten = TRUE;
+    if (WriteTimeline != VK_NULL_HANDLE)
+      TraceWaits.Add(WriteTimeline, WriteValue, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR | VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR);
+  } /* AddGeometryWrite */
+
+  VOID kernel::RetireRecordedBuffers( VOID )
+  {
+    ScratchArena.RetireReplaced();
+  } /* RetireRecordedBuffers */
+
+  std::vector<model *> kernel::CreateModels( std::span<const model_description> Descriptions )
+  {
+    /* Build data of one model */
+    struct model_build
+    {
+      std::vector<VkAccelerationStructureGeometryKHR> Geometries;
+      std::vector<VkAccelerationStructureBuildRangeInfoKHR> RangeInfos;
+    }; /* model_build */
+
+    std::vector<model *> Models {Descriptions.size()};
+    std::vector<model_build> Builds {Descriptions.size()};
+    std::vector<VkAccelerationStructureBuildGeometryInfoKHR> BuildInfos {Descriptions.size()};
+    std::vector<const VkAccelerationStructureBuildRangeInfoKHR *> RangeInfoPointers {Descriptions.size()};
+    std::vector<VkDeviceSize> ScratchSizes(Descriptions.size());
+    std::vector<VkDeviceAddress> ScratchAddresses(Descriptions.size());
+    std::vector<model *> CompactedModels;
+
+    for (SIZE_T m = 0; m < Descriptions.size(); m++)
+    {
+      model *Model = Models[m] = manager<model>::CreateResource();
+
+      // geometry writes are rejected for primitives of static models
+      for (primitive *Prim : Descriptions[m].Primitives)
+      {
+        Prim->Grab();
+        Prim->IsStatic |= !Descriptions[m].IsDynamic;
+      }
+      Model->Primitives = {Descriptions[m].Primitives.begin(), Descriptions[m].Primitives.end()};
+      Model->Kernel = this;
+      Model->TransformMatrix = Descriptions[m].TransformMatrix;
+      Model->IsDynamic = Descriptions[m].IsDynamic;
+      Model->BuildBoundsArea = Model->GetBoundsArea();
+      for (const primitive *Prim : Model->Primitives)
+        Model->BuiltGeometryGenerations.push_back(Prim->GeometryGeneration);
+
+      model_build &Build = Builds[m];
+      Build.Geometries = GetModelGeometries(Model, Build.RangeInfos);
+
+      BuildInfos[m] = VkAccelerationStructureBuildGeometryInfoKHR
+      {
+        /* VkStructureType                                  */ .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
+        /* const void*                                      */ .pNext = nullptr,
+        /* VkAccelerationStructureTypeKHR                   */ .type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+        /* VkBuildAccelerationStructureFlagsKHR             */ .flags = GetModelBuildFlags(Model),
+        /* VkBuildAccelerationStructureModeKHR              */ .mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
+        /* VkAccelerationStructureKHR                       */ .srcAccelerationStructure = VK_NULL_HANDLE,
+        /* VkAccelerationStructureKHR                       */ .dstAccelerationStructure = VK_NULL_HANDLE,
+        /* uint32_t                                         */ .geometryCount = (UINT32)Build.Geometries.size(),
+        /* const VkAccelerationStructureGeometryKHR*        */ .pGeometries = Build.Geometries.data(),
+        /* const VkAccelerationStructureGeometryKHR* const* */ .ppGeometries = nullptr,
+        /* VkDeviceOrHostAddressKHR                         */ .scratchData = {},
+      };
+
+      std::vector<UINT32> PrimitiveCounts(Build.RangeInfos.size());
+      for (SIZE_T i = 0; i < PrimitiveCounts.size(); i++)
+        PrimitiveCounts[i] = Build.RangeInfos[i].primitiveCount;
+
+      VkAccelerationStructureBuildSizesInfoKHR BuildSizesInfo {VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR};
+      vkGetAccelerationStructureBuildSizesKHR(Device, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &BuildInfos[m], PrimitiveCounts.data(), &BuildSizesInfo);
+
+      Model->BLASStorageBuffer = CreateBuffer(BuildSizesInfo.accelerationStructureSize, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+      VkAccelerationStructureCreateInfoKHR AccelerationStructureCreateInfo
+      {
+        /* VkStructureType                       */ .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR,
+        /* const void*                           */ .pNext = nullptr,
+        /* VkAccelerationStructureCreateFlagsKHR */ .createFlags = 0,
+        /* VkBuffer                              */ .buffer = Model->BLASStorageBuffer.Buffer,
+        /* VkDeviceSize                          */ .offset = 0,
+        /* VkDeviceSize                          */ .size = BuildSizesInfo.accelerationStructureSize,
+        /* VkAccelerationStructureTypeKHR        */ .type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+        /* VkDeviceAddress                       */ .deviceAddress = 0,
+      };
+
+      utils::AssertResult(vkCreateAccelerationStructureKHR(Device, &AccelerationStructureCreateInfo, nullptr, &Model->BLAS), "error creating BLAS");
+
+      BuildInfos[m].dstAccelerationStructure = Model->BLAS;
+      RangeInfoPointers[m] = Build.RangeInfos.data();
+      ScratchSizes[m] = Model->BuildScratchSize = BuildSizesInfo.buildScratchSize;
+      Model->UpdateScratchSize = BuildSizesInfo.updateScratchSize;
+
+      // dynamic model is refitted and rebuilt by frames, other models are compacted
+      if (!Model->IsDynamic && DoCompactBLAS)
+        CompactedModels.push_back(Model);
+    }
+
+    if (Models.empty())
+      return Models;
+
+    // compacted sizes are known only after build
+    VkQueryPool QueryPool = VK_NULL_HANDLE;
+    if (!CompactedModels.empty())
+    {
+      VkQueryPoolCreateInfo QueryPoolCreateInfo
+      {
+        /* VkStructureType               */ .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        /* const void*                   */ .pNext = nullptr,
+        /* VkQueryPoolCreateFlags        */ .flags = 0,
+        /* VkQueryType                   */ .queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR,
+        /* uint32_t                      */ .queryCount = (UINT32)CompactedModels.size(),
+        /* VkQueryPipelineStatisticFlags */ .pipelineStatistics = 0,
+      };
+
+      utils::AssertResult(vkCreateQueryPool(Device, &QueryPoolCreateInfo, nullptr, &QueryPool), "error creating compacted size query pool");
+    }
+
+    // all acceleration structures are built by one command, every build has its own scratch range (loader threads don't share frame arena)
+    buffer ScratchBuffer = ScratchArena.CreateStandalone(ScratchSizes, ScratchAddresses);
+    VkCommandBuffer CommandBuffer = BeginSingleTimeCommands();
+    for (SIZE_T m = 0; m < Models.size(); m++)
+      BuildInfos[m].scratchData.deviceAddress = ScratchAddresses[m];
+    vkCmdBuildAccelerationStructuresKHR(CommandBuffer, (UINT32)BuildInfos.size(), BuildInfos.data(), RangeInfoPointers.data());
+
+    if (!CompactedModels.empty())
+    {
+      VkMemoryBarrier BuildBarrier
+      {
+        /* VkStructureType */ .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        /* const void*     */ .pNext = nullptr,
+        /* VkAccessFlags   */ .srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+        /* VkAccessFlags   */ .dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR,
+      };
+
+      std::vector<VkAccelerationStructureKHR> Structures {CompactedModels.size()};
+      for (SIZE_T m = 0; m < CompactedModels.size(); m++)
+        Structures[m] = CompactedModels[m]->BLAS;
+
+      vkCmdResetQueryPool(CommandBuffer, QueryPool, 0, (UINT32)Structures.size());
+      vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1, &BuildBarrier, 0, nullptr, 0, nullptr);
+      vkCmdWriteAccelerationStructuresPropertiesKHR(CommandBuffer, (UINT32)Structures.size(), Structures.data(), VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR, QueryPool, 0);
+    }
+    EndSingleTimeCommands(CommandBuffer);
+    Destroy(ScratchBuffer);
+
+    if (!CompactedModels.empty())
+    {
+      CompactModels(CompactedModels, QueryPool);
+      vkDestroyQueryPool(Device, QueryPool, nullptr);
+    }
+
+    return Models;
+  } /* CreateModels */
+
+  VOID kernel::CompactModels( std::span<model *> Models, VkQueryPool QueryPool )
+  {
+    std::vector<VkDeviceSize> CompactedSizes(Models.size());
+    utils::AssertResult(vkGetQueryPoolResults(Device, QueryPool, 0, (UINT32)Models.size(), CompactedSizes.size() * sizeof(VkDeviceSize), CompactedSizes.data(), sizeof(VkDeviceSize), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT), "error getting compacted sizes");
+
+    std::vector<buffer> OldBuffers;
+    std::vector<VkAccelerationStructureKHR> OldStructures;
+    VkDeviceSize OldSize = 0, NewSize = 0;
+
+    // all copies are recorded into one command buffer
+    VkCommandBuffer CommandBuffer = BeginSingleTimeCommands();
+    for (SIZE_T m = 0; m < Models.size(); m++)
+    {
+      model *Model = Models[m];
+
+      OldSize += Model->BLASStorageBuffer.Size;
+
+      // nothing to gain - model keeps its structure
+      if (CompactedSizes[m] == 0 || CompactedSizes[m] >= Model->BLASStorageBuffer.Size)
+      {
+        NewSize += Model->BLASStorageBuffer.Size;
+        continue;
+      }
+
+      buffer CompactedBuffer = CreateBuffer(CompactedSizes[m], VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+      VkAccelerationStructureCreateInfoKHR AccelerationStructureCreateInfo
+      {
+        /* VkStructureType                       */ .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR,
+        /* const void*                           */ .pNext = nullptr,
+        /* VkAccelerationStructureCreateFlagsKHR */ .createFlags = 0,
+        /* VkBuffer                              */ .buffer = CompactedBuffer.Buffer,
+        /* VkDeviceSize                          */ .offset = 0,
+        /* VkDeviceSize                          */ .size = CompactedSizes[m],
+        /* VkAccelerationStructureTypeKHR        */ .type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+        /* VkDeviceAddress                       */ .deviceAddress = 0,
+      };
+
+      VkAccelerationStructureKHR CompactedBLAS = VK_NULL_HANDLE;
+      utils::AssertResult(vkCreateAccelerationStructureKHR(Device, &AccelerationStructureCreateInfo, nullptr, &CompactedBLAS), "error creating compacted BLAS");
+
+      VkCopyAccelerationStructureInfoKHR CopyInfo
+      {
+        /* VkStructureType                    */ .sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR,
+        /* const void*                        */ .pNext = nullptr,
+        /* VkAccelerationStructureKHR         */ .src = Model->BLAS,
+        /* VkAccelerationStructureKHR         */ .dst = CompactedBLAS,
+        /* VkCopyAccelerationStructureModeKHR */ .mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR,
+      };
+
+      vkCmdCopyAccelerationStructureKHR(CommandBuffer, &CopyInfo);
+
+      OldStructures.push_back(Model->BLAS);
+      OldBuffers.push_back(std::move(Model->BLASStorageBuffer));
+      Model->BLAS = CompactedBLAS;
+      Model->BLASStorageBuffer = std::move(CompactedBuffer);
+      NewSize += CompactedSizes[m];
+    }
+    EndSingleTimeCommands(CommandBuffer);
+
+    // copies are finished - originals aren't used anymore
+    for (VkAccelerationStructureKHR Structure : OldStructures)
+      vkDestroyAccelerationStructureKHR(Device, Structure, nullptr);
+    for (buffer &Buffer : OldBuffers)
+      Destroy(Buffer);
+
+    std::cerr << std::format("acceleration: {} of {} BLAS compacted, {} KB -> {} KB.\n", OldStructures.size(), Models.size(), OldSize >> 10, NewSize >> 10);
+  } /* CompactModels */
+} /* namespace vrt::render::core */
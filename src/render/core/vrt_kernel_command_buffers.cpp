@@ -3,14 +3,14 @@
 namespace vrt::render::core
 {
   /* command buffer creating function */
-  VkCommandBuffer kernel::CreateCommandBuffer( VkCommandPool CommandPool )
+  VkCommandBuffer kernel::CreateCommandBuffer( VkCommandPool CommandPool, VkCommandBufferLevel Level )
   {
     VkCommandBufferAllocateInfo AllocInfo
     {
       /* VkStructureType      */ .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
       /* const void*          */ .pNext = nullptr,
       /* VkCommandPool        */ .commandPool = CommandPool,
-      /* VkCommandBufferLevel */ .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+      /* VkCommandBufferLevel */ .level = Level,
       /* uint32_t             */ .commandBufferCount = 1,
     };
 
@@ -19,15 +19,174 @@ namespace vrt::render::core
     return CommandBuffer;
   } /* CreateCommandBuffer */
 
+  VOID transient_command_allocator::Initialize( kernel *NewKernel, UINT32 NewQueueFamilyIndex, VkSemaphore NewTimeline )
+  {
+    Kernel = NewKernel;
+    QueueFamilyIndex = NewQueueFamilyIndex;
+    Timeline = NewTimeline;
+  } /* Initialize */
+
+  transient_command_allocator::pool * transient_command_allocator::FindPool( VkCommandBuffer CommandBuffer )
+  {
+    auto Contains = [CommandBuffer]( pool *Pool )
+    {
+      return std::find(Pool->CommandBuffers.begin(), Pool->CommandBuffers.begin() + Pool->UsedCount, CommandBuffer) != Pool->CommandBuffers.begin() + Pool->UsedCount;
+    };
+
+    if (Current != nullptr && Contains(Current))
+      return Current;
+
+    for (pool *Pool : Retiring)
+      if (Contains(Pool))
+        return Pool;
+
+    return nullptr;
+  } /* FindPool */
+
+  VkCommandBuffer transient_command_allocator::Allocate( VOID )
+  {
+    if (Current != nullptr && Current->UsedCount == PoolCapacity)
+    {
+      Retiring.push_back(Current);
+      Current = nullptr;
+    }
+
+    if (Current == nullptr)
+    {
+      Recycle();
+
+      if (!Free.empty())
+      {
+        Current = Free.back();
+        Free.pop_back();
+      }
+      else
+      {
+        VkCommandPoolCreateInfo CreateInfo
+        {
+          /* VkStructureType          */ .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+          /* const void*              */ .pNext = nullptr,
+          /* VkCommandPoolCreateFlags */ .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+          /* uint32_t                 */ .queueFamilyIndex = QueueFamilyIndex,
+        };
+
+        Current = new pool;
+        utils::AssertResult(vkCreateCommandPool(Kernel->Device, &CreateInfo, nullptr, &Current->CommandPool), "error creating transient command pool");
+        Pools.push_back(Current);
+      }
+    }
+
+    if (Current->UsedCount == Current->CommandBuffers.size())
+      Current->CommandBuffers.push_back(Kernel->CreateCommandBuffer(Current->CommandPool));
+
+    Current->PendingCount++;
+    return Current->CommandBuffers[Current->UsedCount++];
+  } /* Allocate */
+
+  VOID transient_command_allocator::Submitted( VkCommandBuffer CommandBuffer, UINT64 TimelineValue )
+  {
+    pool *Pool = FindPool(CommandBuffer);
+
+    utils::Assert(Pool != nullptr, "command buffer isn't allocated by this thread");
+
+    Pool->PendingCount--;
+    Pool->RetireValue = std::max(Pool->RetireValue, TimelineValue);
+  } /* Submitted */
+
+  VOID transient_command_allocator::Recycle( VOID )
+  {
+    if (Retiring.empty())
+      return;
+
+    UINT64 Value = 0;
+    vkGetSemaphoreCounterValue(Kernel->Device, Timeline, &Value);
+
+    // pools are filled in order, but may finish out of order - recycle every finished one
+    for (auto Pool = Retiring.begin(); Pool != Retiring.end();)
+      if ((*Pool)->PendingCount == 0 && (*Pool)->RetireValue <= Value)
+      {
+        // all command buffers of pool are reset by one call
+        vkResetCommandPool(Kernel->Device, (*Pool)->CommandPool, 0);
+        (*Pool)->UsedCount = 0;
+        (*Pool)->RetireValue = 0;
+        Free.push_back(*Pool);
+        Pool = Retiring.erase(Pool);
+      }
+      else
+        ++Pool;
+  } /* Recycle */
+
+  VOID transient_command_allocator::Close( VOID )
+  {
+    for (pool *Pool : Pools)
+    {
+      vkDestroyCommandPool(Kernel->Device, Pool->CommandPool, nullptr);
+      delete Pool;
+    }
+
+    Pools.clear();
+    Retiring.clear();
+    Free.clear();
+    Current = nullptr;
+  } /* Close */
+
+  UINT64 kernel::GetNextAllocatorsGeneration( VOID )
+  {
+    static std::atomic<UINT64> NextGeneration = 1;
+
+    return NextGeneration++;
+  } /* GetNextAllocatorsGeneration */
+
+  kernel::thread_command_allocators & kernel::GetThreadCommandAllocators( VOID )
+  {
+    // map is searched once per thread and map generation (0 - nothing cached)
+    thread_local UINT64 CachedGeneration = 0;
+    thread_local thread_command_allocators *CachedAllocators = nullptr;
+
+    if (CachedGeneration == ThreadCommandAllocatorsGeneration && CachedAllocators != nullptr)
+      return *CachedAllocators;
+
+    std::lock_guard<std::mutex> Lock(ThreadCommandAllocatorsMutex);
+
+    std::unique_ptr<thread_command_allocators> &Allocators = ThreadCommandAllocators[std::this_thread::get_id()];
+    if (Allocators == nullptr)
+    {
+      Allocators = std::make_unique<thread_command_allocators>();
+      Allocators->Graphics.Initialize(this, QueueFamilies.Graphics, GraphicsTimeline);
+      Allocators->Transfer.Initialize(this, QueueFamilies.Transfer, TransferTimeline);
+    }
+
+    CachedGeneration = ThreadCommandAllocatorsGeneration;
+    CachedAllocators = Allocators.get();
+
+    return *CachedAllocators;
+  } /* GetThreadCommandAllocators */
+
+  VOID kernel::CloseThreadCommandAllocators( VOID )
+  {
+    std::lock_guard<std::mutex> Lock(ThreadCommandAllocatorsMutex);
+
+    for (auto &[Id, Allocators] : ThreadCommandAllocators)
+    {
+      Allocators->Graphics.Close();
+      Allocators->Transfer.Close();
+    }
+
+    ThreadCommandAllocators.clear();
+
+    // caches of all threads point to destroyed allocators
+    ThreadCommandAllocatorsGeneration = GetNextAllocatorsGeneration();
+  } /* CloseThreadCommandAllocators */
+
   VkCommandBuffer kernel::BeginSingleTimeCommands( VOID )
   {
-    VkCommandBuffer CommandBuffer = CreateCommandBuffer(GraphicsCommandPool);
+    VkCommandBuffer CommandBuffer = GetThreadCommandAllocators().Graphics.Allocate();
 
     VkCommandBufferBeginInfo BeginInfo
     {
       .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
       .pNext = nullptr,
-      .flags = 0,
+      .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
       .pInheritanceInfo = nullptr,
     };
 
@@ -40,35 +199,82 @@ namespace vrt::render::core
   {
     vkEndCommandBuffer(SingleTimeCommandBuffer);
 
-    VkSubmitInfo SubmitInfo
+    // commands are already recorded, so uploaded resources are acquired by separate command buffer submitted before them
+    VkCommandBuffer CommandBuffers[2] {VK_NULL_HANDLE, SingleTimeCommandBuffer};
+    UINT32 CommandBufferCount = 1;
+    UINT64 SignalValue = 0;
+
+    // submission only is serialized - other threads and frames aren't blocked while this one waits for device
     {
-      /* VkStructureType             */ .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-      /* const void*                 */ .pNext = nullptr,
-      /* uint32_t                    */ .waitSemaphoreCount = 0,
-      /* const VkSemaphore*          */ .pWaitSemaphores = nullptr,
-      /* const VkPipelineStageFlags* */ .pWaitDstStageMask = nullptr,
-      /* uint32_t                    */ .commandBufferCount = 1,
-      /* const VkCommandBuffer*      */ .pCommandBuffers = &SingleTimeCommandBuffer,
-      /* uint32_t                    */ .signalSemaphoreCount = 0,
-      /* const VkSemaphore*          */ .pSignalSemaphores = nullptr,
-    };
+      std::lock_guard<std::recursive_mutex> Lock(SubmitMutex);
+
+      // commands may read data that is still being uploaded - wait for it on device
+      UINT64 WaitValue = 0;
+      BOOL DoWaitTransfer = GetGraphicsTransferWait(WaitValue);
+      VkPipelineStageFlags WaitStageFlags = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+      SignalValue = ++GraphicsTimelineValue;
+
+      if (IsAcquirePending())
+      {
+        CommandBuffers[0] = BeginSingleTimeCommands();
+        RecordAcquires(CommandBuffers[0]);
+        vkEndCommandBuffer(CommandBuffers[0]);
+        CommandBufferCount = 2;
+      }
+
+      VkTimelineSemaphoreSubmitInfo TimelineSubmitInfo
+      {
+        /* VkStructureType */ .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        /* const void*     */ .pNext = nullptr,
+        /* uint32_t        */ .waitSemaphoreValueCount = DoWaitTransfer ? 1U : 0U,
+        /* const uint64_t* */ .pWaitSemaphoreValues = &WaitValue,
+        /* uint32_t        */ .signalSemaphoreValueCount = 1,
+        /* const uint64_t* */ .pSignalSemaphoreValues = &SignalValue,
+      };
 
-    vkQueueSubmit(GraphicsQueue, 1, &SubmitInfo, VK_NULL_HANDLE);
+      VkSubmitInfo SubmitInfo
+      {
+        /* VkStructureType             */ .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        /* const void*                 */ .pNext = &TimelineSubmitInfo,
+        /* uint32_t                    */ .waitSemaphoreCount = DoWaitTransfer ? 1U : 0U,
+        /* const VkSemaphore*          */ .pWaitSemaphores = &TransferTimeline,
+        /* const VkPipelineStageFlags* */ .pWaitDstStageMask = &WaitStageFlags,
+        /* uint32_t                    */ .commandBufferCount = CommandBufferCount,
+        /* const VkCommandBuffer*      */ .pCommandBuffers = CommandBuffers + 2 - CommandBufferCount,
+        /* uint32_t                    */ .signalSemaphoreCount = 1,
+        /* const VkSemaphore*          */ .pSignalSemaphores = &GraphicsTimeline,
+      };
 
-    vkQueueWaitIdle(GraphicsQueue);
+      utils::AssertResult(vkQueueSubmit(GraphicsQueue, 1, &SubmitInfo, VK_NULL_HANDLE), "error submitting single time commands");
+    }
 
-    vkFreeCommandBuffers(Device, GraphicsCommandPool, 1, &SingleTimeCommandBuffer);
+    // wait only for this submission, not for whole queue
+    VkSemaphoreWaitInfo WaitInfo
+    {
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .semaphoreCount = 1,
+      .pSemaphores = &GraphicsTimeline,
+      .pValues = &SignalValue,
+    };
+
+    vkWaitSemaphores(Device, &WaitInfo, UINT64_MAX);
+
+    transient_command_allocator &Allocator = GetThreadCommandAllocators().Graphics;
+    for (UINT32 i = 2 - CommandBufferCount; i < 2; i++)
+      Allocator.Submitted(CommandBuffers[i], SignalValue);
   } /* EndSingleTimeCommands */
 
   VkCommandBuffer kernel::BeginTransfer( VOID )
   {
-    VkCommandBuffer CommandBuffer = CreateCommandBuffer(TransferCommandPool);
+    VkCommandBuffer CommandBuffer = GetThreadCommandAllocators().Transfer.Allocate();
 
     VkCommandBufferBeginInfo BeginInfo
     {
       .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
       .pNext = nullptr,
-      .flags = 0,
+      .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
       .pInheritanceInfo = nullptr,
     };
 
@@ -77,27 +283,42 @@ namespace vrt::render::core
     return CommandBuffer;
   } /* BeginTransfer */
 
-  VOID kernel::EndTransfer( VkCommandBuffer CommandBuffer )
+  upload_ticket kernel::EndTransfer( VkCommandBuffer CommandBuffer )
   {
     vkEndCommandBuffer(CommandBuffer);
 
+    std::lock_guard<std::recursive_mutex> Lock(SubmitMutex);
+
+    UINT64 SignalValue = ++TransferTimelineValue;
+
+    VkTimelineSemaphoreSubmitInfo TimelineSubmitInfo
+    {
+      /* VkStructureType */ .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+      /* const void*     */ .pNext = nullptr,
+      /* uint32_t        */ .waitSemaphoreValueCount = 0,
+      /* const uint64_t* */ .pWaitSemaphoreValues = nullptr,
+      /* uint32_t        */ .signalSemaphoreValueCount = 1,
+      /* const uint64_t* */ .pSignalSemaphoreValues = &SignalValue,
+    };
+
     VkSubmitInfo SubmitInfo
     {
       /* VkStructureType             */ .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-      /* const void*                 */ .pNext = nullptr,
+      /* const void*                 */ .pNext = &TimelineSubmitInfo,
       /* uint32_t                    */ .waitSemaphoreCount = 0,
       /* const VkSemaphore*          */ .pWaitSemaphores = nullptr,
       /* const VkPipelineStageFlags* */ .pWaitDstStageMask = nullptr,
       /* uint32_t                    */ .commandBufferCount = 1,
       /* const VkCommandBuffer*      */ .pCommandBuffers = &CommandBuffer,
-      /* uint32_t                    */ .signalSemaphoreCount = 0,
-      /* const VkSemaphore*          */ .pSignalSemaphores = nullptr,
+      /* uint32_t                    */ .signalSemaphoreCount = 1,
+      /* const VkSemaphore*          */ .pSignalSemaphores = &TransferTimeline,
     };
 
-    vkQueueSubmit(TransferQueue, 1, &SubmitInfo, VK_NULL_HANDLE);
+    utils::AssertResult(vkQueueSubmit(TransferQueue, 1, &SubmitInfo, VK_NULL_HANDLE), "error submitting transfer");
 
-    vkQueueWaitIdle(TransferQueue);
+    // command buffer is reused after transfer timeline passes its value
+    GetThreadCommandAllocators().Transfer.Submitted(CommandBuffer, SignalValue);
 
-    vkFreeCommandBuffers(Device, TransferCommandPool, 1, &CommandBuffer);
+    return upload_ticket {SignalValue};
   } /* EndTransfer */
 } /* namespace vrt::render::core */
\ No newline at end of file
@@ -55,7 +55,14 @@ namespace vrt::render::core
     {
       if (utils::CheckFlags(QueueFamilyProperties[i].queueFlags, VK_QUEUE_GRAPHICS_BIT)) QueueFamilies.Graphics = i;
       if (utils::CheckFlags(QueueFamilyProperties[i].queueFlags, VK_QUEUE_TRANSFER_BIT)) QueueFamilies.Transfer = i;
-      if (utils::CheckFlags(QueueFamilyProperties[i].queueFlags, VK_QUEUE_COMPUTE_BIT))  QueueFamilies.Compute  = i;
+
+      // dedicated compute family is preferred - post processing overlaps with raytracing on it
+      if (utils::CheckFlags(QueueFamilyProperties[i].queueFlags, VK_QUEUE_COMPUTE_BIT))
+        if (QueueFamilies.Compute == UINT32_MAX || !utils::CheckFlags(QueueFamilyProperties[i].queueFlags, VK_QUEUE_GRAPHICS_BIT))
+          QueueFamilies.Compute = i;
+
+      if (IsHeadless())
+        continue;
 
       VkBool32 SurfaceSupport = VK_FALSE;
       utils::AssertResult(vkGetPhysicalDeviceSurfaceSupportKHR(PhysicalDevice, i, Surface, &SurfaceSupport));
@@ -63,7 +70,9 @@ namespace vrt::render::core
         QueueFamilies.Present = i;
     }
 
-    std::set<UINT32> UniqueQueueFamilies {QueueFamilies.Compute, QueueFamilies.Graphics, QueueFamilies.Present, QueueFamilies.Transfer};
+    std::set<UINT32> UniqueQueueFamilies {QueueFamilies.Compute, QueueFamilies.Graphics, QueueFamilies.Transfer};
+    if (!IsHeadless())
+      UniqueQueueFamilies.insert(QueueFamilies.Present);
     QueueFamilies.Unique.reserve(UniqueQueueFamilies.size());
     for (UINT32 Family : UniqueQueueFamilies)
       QueueFamilies.Unique.push_back(Family);
@@ -71,7 +80,7 @@ namespace vrt::render::core
     utils::Assert
     (
       QueueFamilies.Graphics != UINT32_MAX &&
-      QueueFamilies.Present  != UINT32_MAX &&
+      (QueueFamilies.Present != UINT32_MAX || IsHeadless()) &&
       QueueFamilies.Transfer != UINT32_MAX &&
       QueueFamilies.Compute  != UINT32_MAX,
       "no required queue family presented"
@@ -105,12 +114,30 @@ namespace vrt::render::core
     VkPhysicalDeviceRayQueryFeaturesKHR RayQueryFeatures {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_QUERY_FEATURES_KHR, &RTPipelineFeatures};
     VkPhysicalDeviceAccelerationStructureFeaturesKHR AccelerationStructureFeatures {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR, &RayQueryFeatures};
     VkPhysicalDeviceBufferDeviceAddressFeatures BufferDeviceAddressFeatures {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES, &AccelerationStructureFeatures};
-    VkPhysicalDeviceDescriptorIndexingFeatures DescriptorIndexingFeatures {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES, &BufferDeviceAddressFeatures};
+    VkPhysicalDeviceTimelineSemaphoreFeatures TimelineSemaphoreFeatures {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES, &BufferDeviceAddressFeatures};
+    VkPhysicalDeviceDescriptorIndexingFeatures DescriptorIndexingFeatures {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES, &TimelineSemaphoreFeatures};
     VkPhysicalDeviceFeatures2 EnabledDeviceFeatures {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, &DescriptorIndexingFeatures};
 
     vkGetPhysicalDeviceFeatures2(PhysicalDevice, &EnabledDeviceFeatures);
     vkGetPhysicalDeviceProperties2(PhysicalDevice, &PhysicalDeviceProperties.Properties2);
 
+    // optional extensions
+    UINT32 ExtensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(PhysicalDevice, nullptr, &ExtensionCount, nullptr);
+    std::vector<VkExtensionProperties> Extensions {ExtensionCount};
+    vkEnumerateDeviceExtensionProperties(PhysicalDevice, nullptr, &ExtensionCount, Extensions.data());
+
+    // there is nothing to present to without window
+    if (IsHeadless())
+      std::erase_if(EnabledDeviceExtensions, []( const CHAR *Name ) { return std::strcmp(Name, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0; });
+
+    for (const VkExtensionProperties &Extension : Extensions)
+      if (std::strcmp(Extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0)
+      {
+        EnabledDeviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        IsMemoryBudgetSupported = TRUE;
+      }
+
     VkDeviceCreateInfo CreateInfo
     {
       /* VkStructureType                 */ .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
@@ -130,7 +157,8 @@ namespace vrt::render::core
 
     vkGetDeviceQueue(Device, QueueFamilies.Compute, 0, &ComputeQueue);
     vkGetDeviceQueue(Device, QueueFamilies.Graphics, 0, &GraphicsQueue);
-    vkGetDeviceQueue(Device, QueueFamilies.Present, 0, &PresentQueue);
+    if (!IsHeadless())
+      vkGetDeviceQueue(Device, QueueFamilies.Present, 0, &PresentQueue);
     vkGetDeviceQueue(Device, QueueFamilies.Transfer, 0, &TransferQueue);
   } /* InitPhysicalDevice */
 } /* namespace vrt::render */
\ No newline at end of file
@@ -0,0 +1,469 @@
+#include "vrt.h"
+
+namespace vrt::render::core
+{
+  VOID range_allocator::Initialize( VkDeviceSize NewCapacity )
+  {
+    FreeByOffset.clear();
+    FreeBySize.clear();
+
+    Capacity = NewCapacity;
+    Used = 0;
+
+    if (Capacity != 0)
+      InsertFree(0, Capacity);
+  } /* Initialize */
+
+  VOID range_allocator::InsertFree( VkDeviceSize Offset, VkDeviceSize Size )
+  {
+    FreeByOffset.insert({Offset, Size});
+    FreeBySize.insert({Size, Offset});
+  } /* InsertFree */
+
+  VOID range_allocator::EraseFree( std::map<VkDeviceSize, VkDeviceSize>::iterator Range )
+  {
+    auto [First, Last] = FreeBySize.equal_range(Range->second);
+
+    for (auto Iter = First; Iter != Last; ++Iter)
+      if (Iter->second == Range->first)
+      {
+        FreeBySize.erase(Iter);
+        break;
+      }
+
+    FreeByOffset.erase(Range);
+  } /* EraseFree */
+
+  VkDeviceSize range_allocator::Allocate( VkDeviceSize Size, VkDeviceSize Alignment )
+  {
+    if (Size == 0)
+      Size = 1;
+    if (Alignment == 0)
+      Alignment = 1;
+
+    // best fit: smallest free range that can hold aligned allocation
+    for (auto Iter = FreeBySize.lower_bound(Size); Iter != FreeBySize.end(); ++Iter)
+    {
+      VkDeviceSize RangeOffset = Iter->second, RangeSize = Iter->first;
+      VkDeviceSize AlignedOffset = utils::Align(RangeOffset, Alignment);
+
+      if (AlignedOffset + Size > RangeOffset + RangeSize)
+        continue;
+
+      FreeBySize.erase(Iter);
+      FreeByOffset.erase(RangeOffset);
+
+      // return alignment padding and tail back to free list
+      if (AlignedOffset != RangeOffset)
+        InsertFree(RangeOffset, AlignedOffset - RangeOffset);
+      if (AlignedOffset + Size != RangeOffset + RangeSize)
+        InsertFree(AlignedOffset + Size, RangeOffset + RangeSize - AlignedOffset - Size);
+
+      Used += Size;
+      return AlignedOffset;
+    }
+
+    return InvalidOffset;
+  } /* Allocate */
+
+  VOID range_allocator::Free( VkDeviceSize Offset, VkDeviceSize Size )
+  {
+    if (Size == 0)
+      Size = 1;
+
+    Used -= Size;
+
+    // coalesce with next range
+    auto Next = FreeByOffset.lower_bound(Offset);
+    if (Next != FreeByOffset.end() && Offset + Size == Next->first)
+    {
+      Size += Next->second;
+      EraseFree(Next);
+    }
+
+    // coalesce with previous range
+    Next = FreeByOffset.lower_bound(Offset);
+    if (Next != FreeByOffset.begin())
+    {
+      auto Prev = std::prev(Next);
+
+      if (Prev->first + Prev->second == Offset)
+      {
+        Offset = Prev->first;
+        Size += Prev->second;
+        EraseFree(Prev);
+      }
+    }
+
+    InsertFree(Offset, Size);
+  } /* Free */
+
+
+  VOID memory_allocator::Initialize( kernel *NewKernel, BOOL NewIsBudgetSupported )
+  {
+    Kernel = NewKernel;
+    IsBudgetSupported = NewIsBudgetSupported;
+
+    vkGetPhysicalDeviceMemoryProperties(Kernel->PhysicalDevice, &MemoryProperties);
+    BufferImageGranularity = std::max<VkDeviceSize>(Kernel->PhysicalDeviceProperties.Properties.limits.bufferImageGranularity, 1);
+
+    Blocks.resize(MemoryProperties.memoryTypeCount);
+
+    UpdateBudget();
+  } /* Initialize */
+
+  VOID memory_allocator::UpdateBudget( VOID )
+  {
+    if (IsBudgetSupported)
+    {
+      VkPhysicalDeviceMemoryBudgetPropertiesEXT BudgetProperties {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT};
+      VkPhysicalDeviceMemoryProperties2 MemoryProperties2 {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2, &BudgetProperties};
+
+      vkGetPhysicalDeviceMemoryProperties2(Kernel->PhysicalDevice, &MemoryProperties2);
+
+      for (UINT32 i = 0; i < MemoryProperties.memoryHeapCount; i++)
+      {
+        HeapBudget[i] = BudgetProperties.heapBudget[i];
+        HeapUsage[i] = BudgetProperties.heapUsage[i];
+        HeapAllocatedAtUpdate[i] = HeapAllocated[i];
+      }
+    }
+    else
+    {
+      // no driver data - assume 80% of heap is available, count only own allocations
+      for (UINT32 i = 0; i < MemoryProperties.memoryHeapCount; i++)
+      {
+        HeapBudget[i] = MemoryProperties.memoryHeaps[i].size / 10 * 8;
+        HeapUsage[i] = 0;
+        HeapAllocatedAtUpdate[i] = 0;
+      }
+    }
+  } /* UpdateBudget */
+
+  memory_budget memory_allocator::GetBudget( UINT32 HeapIndex ) const
+  {
+    memory_budget Budget;
+
+    Budget.Budget = HeapBudget[HeapIndex];
+    Budget.AllocatorBytes = HeapAllocated[HeapIndex];
+
+    // driver usage is refreshed on update only, so allocations made since update are accounted here
+    VkDeviceSize Usage = HeapUsage[HeapIndex] + HeapAllocated[HeapIndex];
+    Budget.Usage = Usage > HeapAllocatedAtUpdate[HeapIndex] ? Usage - HeapAllocatedAtUpdate[HeapIndex] : 0;
+
+    return Budget;
+  } /* GetBudget */
+
+  UINT32 memory_allocator::FindMemoryType( UINT32 TypeFilter, VkMemoryPropertyFlags RequiredFlags, VkMemoryPropertyFlags PreferredFlags, VkDeviceSize Size ) const
+  {
+    UINT32 BestType = UINT32_MAX;
+    INT BestScore = -1;
+
+    for (UINT32 i = 0; i < MemoryProperties.memoryTypeCount; i++)
+    {
+      VkMemoryPropertyFlags Flags = MemoryProperties.memoryTypes[i].propertyFlags;
+
+      if ((TypeFilter & (1U << i)) == 0 || !utils::CheckFlags(Flags, RequiredFlags))
+        continue;
+
+      // fitting in budget outweighs any number of preferred flags
+      memory_budget Budget = GetBudget(MemoryProperties.memoryTypes[i].heapIndex);
+      INT Score = std::popcount(Flags & PreferredFlags) + (Budget.Usage + Size <= Budget.Budget ? 32 : 0);
+
+      if (Score > BestScore)
+      {
+        BestType = i;
+        BestScore = Score;
+      }
+    }
+
+    return BestType;
+  } /* FindMemoryType */
+
+  VkDeviceSize memory_allocator::GetBlockSize( UINT32 MemoryTypeIndex ) const
+  {
+    VkDeviceSize HeapSize = MemoryProperties.memoryHeaps[MemoryProperties.memoryTypes[MemoryTypeIndex].heapIndex].size;
+
+    // small heaps (e.g. 256MB BAR) get proportionally smaller blocks
+    return std::min(DefaultBlockSize, HeapSize / 8);
+  } /* GetBlockSize */
+
+  memory_block * memory_allocator::CreateBlock( UINT32 MemoryTypeIndex, VkDeviceSize Size, BOOL IsDedicated )
+  {
+    // every block can back buffers with device address
+    VkMemoryAllocateFlagsInfo AllocateFlagsInfo
+    {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO,
+      .pNext = nullptr,
+      .flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT,
+      .deviceMask = 0,
+    };
+
+    VkMemoryAllocateInfo AllocateInfo
+    {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+      .pNext = &AllocateFlagsInfo,
+      .allocationSize = Size,
+      .memoryTypeIndex = MemoryTypeIndex,
+    };
+
+    VkDeviceMemory Memory = VK_NULL_HANDLE;
+    if (vkAllocateMemory(Kernel->Device, &AllocateInfo, nullptr, &Memory) != VK_SUCCESS)
+      return nullptr;
+
+    HeapAllocated[MemoryProperties.memoryTypes[MemoryTypeIndex].heapIndex] += Size;
+
+    memory_block *Block = new memory_block;
+
+    Block->Memory = Memory;
+    Block->Size = Size;
+    Block->MemoryTypeIndex = MemoryTypeIndex;
+    Block->IsDedicated = IsDedicated;
+    Block->Ranges.Initialize(Size);
+
+    // host-visible blocks are mapped once for their whole lifetime
+    if (utils::CheckFlags(MemoryProperties.memoryTypes[MemoryTypeIndex].propertyFlags, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
+    {
+      VOID *Data = nullptr;
+      utils::AssertResult(vkMapMemory(Kernel->Device, Memory, 0, VK_WHOLE_SIZE, 0, &Data), "error mapping memory block");
+      Block->MappedData = reinterpret_cast<BYTE *>(Data);
+    }
+
+    Blocks[MemoryTypeIndex].push_back(Block);
+
+    return Block;
+  } /* CreateBlock */
+
+  VOID memory_allocator::DestroyBlock( memory_block *Block )
+  {
+    std::vector<memory_block *> &TypeBlocks = Blocks[Block->MemoryTypeIndex];
+    TypeBlocks.erase(std::find(TypeBlocks.begin(), TypeBlocks.end(), Block));
+
+    if (Block->MappedData != nullptr)
+      vkUnmapMemory(Kernel->Device, Block->Memory);
+    vkFreeMemory(Kernel->Device, Block->Memory, nullptr);
+
+    HeapAllocated[MemoryProperties.memoryTypes[Block->MemoryTypeIndex].heapIndex] -= Block->Size;
+
+    delete Block;
+  } /* DestroyBlock */
+
+  BOOL memory_allocator::EvictEmptyBlocks( UINT32 HeapIndex )
+  {
+    BOOL IsEvicted = FALSE;
+
+    for (UINT32 i = 0; i < MemoryProperties.memoryTypeCount; i++)
+    {
+      if (MemoryProperties.memoryTypes[i].heapIndex != HeapIndex)
+        continue;
+
+      for (SIZE_T b = Blocks[i].size(); b > 0; b--)
+        if (Blocks[i][b - 1]->AllocationCount == 0)
+        {
+          DestroyBlock(Blocks[i][b - 1]);
+          IsEvicted = TRUE;
+        }
+    }
+
+    return IsEvicted;
+  } /* EvictEmptyBlocks */
+
+  memory_allocation memory_allocator::AllocateFromType( VkDeviceSize Size, VkDeviceSize Alignment, UINT32 MemoryTypeIndex )
+  {
+    VkDeviceSize BlockSize = GetBlockSize(MemoryTypeIndex);
+    VkDeviceSize Offset = range_allocator::InvalidOffset;
+    memory_block *Block = nullptr;
+
+    if (Size > BlockSize / 2)
+    {
+      // large resources get their own memory object
+      Block = CreateBlock(MemoryTypeIndex, Size, TRUE);
+      if (Block != nullptr)
+        Offset = Block->Ranges.Allocate(Size, 1);
+    }
+    else
+    {
+      for (memory_block *Candidate : Blocks[MemoryTypeIndex])
+      {
+        if (Candidate->IsDedicated || Candidate->Ranges.GetLargestFreeRange() < Size)
+          continue;
+
+        Offset = Candidate->Ranges.Allocate(Size, Alignment);
+        if (Offset != range_allocator::InvalidOffset)
+        {
+          Block = Candidate;
+          break;
+        }
+      }
+
+      if (Block == nullptr)
+      {
+        Block = CreateBlock(MemoryTypeIndex, BlockSize, FALSE);
+
+        // whole block doesn't fit - try to allocate exactly what is needed
+        if (Block == nullptr)
+          Block = CreateBlock(MemoryTypeIndex, Size, TRUE);
+
+        if (Block != nullptr)
+          Offset = Block->Ranges.Allocate(Size, Alignment);
+      }
+    }
+
+    if (Block == nullptr)
+      return memory_allocation {};
+
+    Block->AllocationCount++;
+
+    return memory_allocation
+    {
+      .Memory = Block->Memory,
+      .Offset = Offset,
+      .Size = Size,
+      .MappedData = Block->MappedData == nullptr ? nullptr : Block->MappedData + Offset,
+      .Block = Block,
+    };
+  } /* AllocateFromType */
+
+  memory_allocation memory_allocator::AllocateFromTypes( VkDeviceSize Size, VkDeviceSize Alignment, UINT32 &TypeFilter, VkMemoryPropertyFlags RequiredFlags, VkMemoryPropertyFlags PreferredFlags )
+  {
+    UINT32 MemoryTypeIndex;
+
+    while ((MemoryTypeIndex = FindMemoryType(TypeFilter, RequiredFlags, PreferredFlags, Size)) != UINT32_MAX)
+    {
+      UINT32 HeapIndex = MemoryProperties.memoryTypes[MemoryTypeIndex].heapIndex;
+      memory_budget Budget = GetBudget(HeapIndex);
+
+      if (Budget.Usage + Size > Budget.Budget)
+      {
+        // cached blocks are first to go when heap is over budget
+        EvictEmptyBlocks(HeapIndex);
+
+        if (!IsOverBudgetReported[HeapIndex])
+        {
+          std::cerr << std::format("memory: heap {} is over budget ({} of {} MB used)\n", HeapIndex, Budget.Usage >> 20, Budget.Budget >> 20);
+          IsOverBudgetReported[HeapIndex] = TRUE;
+        }
+      }
+
+      memory_allocation Allocation = AllocateFromType(Size, Alignment, MemoryTypeIndex);
+
+      // device is out of memory - release everything that isn't used anymore and retry
+      if (Allocation.Block == nullptr)
+      {
+        Kernel->CollectRetired();
+        if (EvictEmptyBlocks(HeapIndex))
+          Allocation = AllocateFromType(Size, Alignment, MemoryTypeIndex);
+      }
+
+      if (Allocation.Block != nullptr)
+        return Allocation;
+
+      TypeFilter &= ~(1U << MemoryTypeIndex);
+    }
+
+    return memory_allocation {};
+  } /* AllocateFromTypes */
+
+  memory_allocation memory_allocator::Allocate( const VkMemoryRequirements &Requirements, VkMemoryPropertyFlags RequiredFlags, VkMemoryPropertyFlags PreferredFlags, BOOL IsOptimalImage )
+  {
+    VkDeviceSize Size = Requirements.size, Alignment = Requirements.alignment;
+
+    // optimal images occupy whole granularity pages, so they never share a page with linear resources
+    if (IsOptimalImage)
+    {
+      Alignment = std::max(Alignment, BufferImageGranularity);
+      Size = utils::Align(Size, BufferImageGranularity);
+    }
+
+    UINT32 TypeFilter = Requirements.memoryTypeBits;
+    memory_allocation Allocation = AllocateFromTypes(Size, Alignment, TypeFilter, RequiredFlags, PreferredFlags);
+
+    // device local memory is exhausted - place resource into host memory, device reads it through bus
+    if (Allocation.Block == nullptr && utils::CheckFlags(RequiredFlags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+    {
+      std::cerr << std::format("memory: device local memory is exhausted, {} KB resource is placed into host memory\n", Size >> 10);
+      Allocation = AllocateFromTypes(Size, Alignment, TypeFilter, RequiredFlags & ~VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, PreferredFlags);
+    }
+
+    utils::Assert(Allocation.Block != nullptr, "out of device memory");
+
+    return Allocation;
+  } /* Allocate */
+
+  VOID memory_allocator::Free( memory_allocation &Allocation )
+  {
+    memory_block *Block = Allocation.Block;
+
+    if (Block == nullptr)
+      return;
+
+    Block->Ranges.Free(Allocation.Offset, Allocation.Size);
+    Block->AllocationCount--;
+    Allocation = memory_allocation {};
+
+    if (Block->AllocationCount != 0)
+      return;
+
+    if (Block->IsDedicated)
+    {
+      DestroyBlock(Block);
+      return;
+    }
+
+    // keep one empty block per memory type to avoid allocation thrashing
+    for (memory_block *Other : Blocks[Block->MemoryTypeIndex])
+      if (Other != Block && !Other->IsDedicated && Other->AllocationCount == 0)
+      {
+        DestroyBlock(Block);
+        return;
+      }
+  } /* Free */
+
+  VOID memory_allocator::CollectStats( UINT32 MemoryTypeIndex, memory_stats &Stats ) const
+  {
+    for (const memory_block *Block : Blocks[MemoryTypeIndex])
+    {
+      Stats.BlockCount++;
+      Stats.DedicatedBlockCount += Block->IsDedicated;
+      Stats.AllocationCount += Block->AllocationCount;
+      Stats.BytesReserved += Block->Size;
+      Stats.BytesInUse += Block->Ranges.GetUsed();
+      Stats.FreeRangeCount += Block->Ranges.GetFreeRangeCount();
+      Stats.LargestFreeRange = std::max(Stats.LargestFreeRange, Block->Ranges.GetLargestFreeRange());
+    }
+  } /* CollectStats */
+
+  memory_stats memory_allocator::GetStats( UINT32 MemoryTypeIndex ) const
+  {
+    memory_stats Stats;
+
+    CollectStats(MemoryTypeIndex, Stats);
+
+    VkDeviceSize FreeBytes = Stats.BytesReserved - Stats.BytesInUse;
+    Stats.Fragmentation = FreeBytes == 0 ? 0.0f : 1.0f - (FLOAT)((DOUBLE)Stats.LargestFreeRange / (DOUBLE)FreeBytes);
+
+    return Stats;
+  } /* GetStats */
+
+  memory_stats memory_allocator::GetStats( VOID ) const
+  {
+    memory_stats Stats;
+
+    for (UINT32 i = 0; i < MemoryProperties.memoryTypeCount; i++)
+      CollectStats(i, Stats);
+
+    VkDeviceSize FreeBytes = Stats.BytesReserved - Stats.BytesInUse;
+    Stats.Fragmentation = FreeBytes == 0 ? 0.0f : 1.0f - (FLOAT)((DOUBLE)Stats.LargestFreeRange / (DOUBLE)FreeBytes);
+
+    return Stats;
+  } /* GetStats */
+
+  VOID memory_allocator::Close( VOID )
+  {
+    for (std::vector<memory_block *> &TypeBlocks : Blocks)
+      while (!TypeBlocks.empty())
+        DestroyBlock(TypeBlocks.back());
+
+    Blocks.clear();
+  } /* Close */
+} /* namespace vrt::render::core */
@@ -0,0 +1,176 @@
+#include "vrt.h"
+
+namespace vrt::render::core
+{
+  VOID kernel::InitializePostImages( VOID )
+  {
+    for (image &PostImage : PostImages)
+    {
+      PostImage = CreateImage(SwapchainImageExtent.width, SwapchainImageExtent.height, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+      TransferImageLayout(PostImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL); // reset image layout
+    }
+
+    // results of previous images are lost, so next frame presents its own result
+    PostResetValue = PresentedPostValue = PostValue;
+  } /* InitializePostImages */
+
+  VOID kernel::DestroyPostImages( VOID )
+  {
+    for (image &PostImage : PostImages)
+      Destroy(PostImage);
+  } /* DestroyPostImages */
+
+  VOID kernel::WritePostDescriptors( VOID )
+  {
+    std::array<VkDescriptorImageInfo, PostImageCount> DescriptorImageInfos;
+
+    for (UINT32 i = 0; i < PostImageCount; i++)
+      DescriptorImageInfos[i] = VkDescriptorImageInfo
+      {
+        .sampler = TargetImageSampler,
+        .imageView = PostImages[i].ImageView,
+        .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+      };
+
+    VkWriteDescriptorSet DescriptorSetWrite
+    {
+      /* VkStructureType               */ .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+      /* const void*                   */ .pNext = nullptr,
+      /* VkDescriptorSet               */ .dstSet = PresentDescriptorSet,
+      /* uint32_t                      */ .dstBinding = 0,
+      /* uint32_t                      */ .dstArrayElement = 0,
+      /* uint32_t                      */ .descriptorCount = PostImageCount,
+      /* VkDescriptorType              */ .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+      /* const VkDescriptorImageInfo*  */ .pImageInfo = DescriptorImageInfos.data(),
+      /* const VkDescriptorBufferInfo* */ .pBufferInfo = nullptr,
+      /* const VkBufferView*           */ .pTexelBufferView = nullptr,
+    };
+
+    vkUpdateDescriptorSets(Device, 1, &DescriptorSetWrite, 0, nullptr);
+  } /* WritePostDescriptors */
+
+  BOOL kernel::RecordPost( frame &Frame, UINT32 PostImageIndex, UINT32 PresentImageIndex, BOOL DoAcquirePresentImage, UINT32 PresentBufferOffset )
+  {
+    // images stay in general layout, barriers transfer ownership and make writes visible only
+    auto GetPostImageBarrier = [&]( UINT32 Index, VkAccessFlags SrcAccessMask, VkAccessFlags DstAccessMask, UINT32 SrcQueueFamily, UINT32 DstQueueFamily )
+    {
+      return VkImageMemoryBarrier
+      {
+        /* VkStructureType         */ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        /* const void*             */ .pNext = nullptr,
+        /* VkAccessFlags           */ .srcAccessMask = SrcAccessMask,
+        /* VkAccessFlags           */ .dstAccessMask = DstAccessMask,
+        /* VkImageLayout           */ .oldLayout = VK_IMAGE_LAYOUT_GENERAL,
+        /* VkImageLayout           */ .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+        /* uint32_t                */ .srcQueueFamilyIndex = SrcQueueFamily,
+        /* uint32_t                */ .dstQueueFamilyIndex = DstQueueFamily,
+        /* VkImage                 */ .image = PostImages[Index].Image,
+        /* VkImageSubresourceRange */ .subresourceRange = VkImageSubresourceRange
+        {
+          /* VkImageAspectFlags */ .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+          /* uint32_t           */ .baseMipLevel = 0,
+          /* uint32_t           */ .levelCount = 1,
+          /* uint32_t           */ .baseArrayLayer = 0,
+          /* uint32_t           */ .layerCount = 1,
+        },
+      };
+    };
+
+    // same family - semaphores between queues are enough
+    BOOL IsTransferRequired = IsPostOwnershipTransferRequired();
+
+    VkCommandBufferBeginInfo BeginInfo
+    {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      .pNext = nullptr,
+      .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+      .pInheritanceInfo = nullptr,
+    };
+
+    // target image is copied, so next frame can accumulate into it while this one is processed
+    vkBeginCommandBuffer(Frame.PostCommandBuffer, &BeginInfo);
+    {
+      // post image was read by presentation of frame before previous one
+      VkImageMemoryBarrier CopyBarrier = GetPostImageBarrier(PostImageIndex, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED);
+      vkCmdPipelineBarrier(Frame.PostCommandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &CopyBarrier);
+
+      VkImageSubresourceLayers Subresource
+      {
+        /* VkImageAspectFlags */ .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        /* uint32_t           */ .mipLevel = 0,
+        /* uint32_t           */ .baseArrayLayer = 0,
+        /* uint32_t           */ .layerCount = 1,
+      };
+
+      VkImageCopy Region
+      {
+        /* VkImageSubresourceLayers */ .srcSubresource = Subresource,
+        /* VkOffset3D               */ .srcOffset = {0, 0, 0},
+        /* VkImageSubresourceLayers */ .dstSubresource = Subresource,
+        /* VkOffset3D               */ .dstOffset = {0, 0, 0},
+        /* VkExtent3D               */ .extent = {SwapchainImageExtent.width, SwapchainImageExtent.height, 1},
+      };
+
+      vkCmdCopyImage(Frame.PostCommandBuffer, TargetImage.Image, VK_IMAGE_LAYOUT_GENERAL, PostImages[PostImageIndex].Image, VK_IMAGE_LAYOUT_GENERAL, 1, &Region);
+
+      if (IsTransferRequired)
+      {
+        VkImageMemoryBarrier ReleaseBarrier = GetPostImageBarrier(PostImageIndex, VK_ACCESS_TRANSFER_WRITE_BIT, 0, QueueFamilies.Graphics, QueueFamilies.Compute);
+        vkCmdPipelineBarrier(Frame.PostCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &ReleaseBarrier);
+      }
+    }
+    vkEndCommandBuffer(Frame.PostCommandBuffer);
+
+    // accumulation resolve and tone mapping on compute queue
+    vkBeginCommandBuffer(Frame.ComputeCommandBuffer, &BeginInfo);
+    {
+      if (IsTransferRequired)
+      {
+        VkImageMemoryBarrier AcquireBarrier = GetPostImageBarrier(PostImageIndex, 0, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, QueueFamilies.Graphics, QueueFamilies.Compute);
+        vkCmdPipelineBarrier(Frame.ComputeCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &AcquireBarrier);
+      }
+
+      vkCmdBindPipeline(Frame.ComputeCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, PostPipeline);
+      vkCmdBindDescriptorSets(Frame.ComputeCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, PresentPipelineLayout, 0, 1, &PresentDescriptorSet, 1, &PresentBufferOffset);
+      vkCmdDispatch(Frame.ComputeCommandBuffer, (SwapchainImageExtent.width + 7) / 8, (SwapchainImageExtent.height + 7) / 8, 1);
+
+      if (IsTransferRequired)
+      {
+        VkImageMemoryBarrier ReleaseBarrier = GetPostImageBarrier(PostImageIndex, VK_ACCESS_SHADER_WRITE_BIT, 0, QueueFamilies.Compute, QueueFamilies.Graphics);
+        vkCmdPipelineBarrier(Frame.ComputeCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &ReleaseBarrier);
+      }
+    }
+    vkEndCommandBuffer(Frame.ComputeCommandBuffer);
+
+    if (!IsTransferRequired || !DoAcquirePresentImage)
+      return FALSE;
+
+    // presented image is acquired back by graphics queue
+    vkBeginCommandBuffer(Frame.PresentCommandBuffer, &BeginInfo);
+    {
+      VkImageMemoryBarrier AcquireBarrier = GetPostImageBarrier(PresentImageIndex, 0, VK_ACCESS_SHADER_READ_BIT, QueueFamilies.Compute, QueueFamilies.Graphics);
+      vkCmdPipelineBarrier(Frame.PresentCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &AcquireBarrier);
+    }
+    vkEndCommandBuffer(Frame.PresentCommandBuffer);
+
+    return TRUE;
+  } /* RecordPost */
+
+  VOID kernel::WaitPost( UINT64 Value )
+  {
+    if (Value == 0)
+      return;
+
+    VkSemaphoreWaitInfo WaitInfo
+    {
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .semaphoreCount = 1,
+      .pSemaphores = &PostTimeline,
+      .pValues = &Value,
+    };
+
+    utils::AssertResult(vkWaitSemaphores(Device, &WaitInfo, UINT64_MAX), "error waiting for post processing");
+  } /* WaitPost */
+} /* namespace vrt::render::core */
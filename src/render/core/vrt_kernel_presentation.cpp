@@ -5,11 +5,14 @@ namespace vrt::render::core
 {
   VOID kernel::InitializePresentResources( VOID )
   {
-    InitializeSwapchain();
-    InitializePresentRenderPass();
-    InitializeFramebuffers();
+    // headless target has extent passed on initialization, presentation objects need swapchain extension
+    if (!IsHeadless())
+    {
+      InitializeSwapchain();
+      InitializePresentRenderPass();
+      InitializeFramebuffers();
+    }
     InitializeTarget();
-    PresentBuffer = CreateBuffer(sizeof(present_buffer_data), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
   } /* InitializePresent */
 
   VOID kernel::InitializeSwapchain( VOID )
@@ -43,35 +46,22 @@ namespace vrt::render::core
         break;
       }
 
-    // choose present mode
-    VkPresentModeKHR PresentMode = VK_PRESENT_MODE_FIFO_KHR;
+    // choose present mode - FIFO is always supported
+    PresentMode = VK_PRESENT_MODE_FIFO_KHR;
     for (VkPresentModeKHR mode : SwapchainSupportDetails.PresentModes)
-      if (mode == VK_PRESENT_MODE_MAILBOX_KHR)
+      if (mode == PresentPolicy.PresentMode)
       {
         PresentMode = mode;
         break;
       }
 
     // get swapchain extent
-    if (SwapchainSupportDetails.Capabilities.currentExtent.width != UINT32_MAX)
-      SwapchainImageExtent = SwapchainSupportDetails.Capabilities.currentExtent;
-    else
-    {
-      struct
-      {
-        INT width, height;
-      } windowExtent;
-
-      SDL_GetWindowSize(Window, &windowExtent.width, &windowExtent.height);
-
-      SwapchainImageExtent.width = std::clamp<UINT32>(windowExtent.width, SwapchainSupportDetails.Capabilities.minImageExtent.width, SwapchainSupportDetails.Capabilities.maxImageExtent.width);
-      SwapchainImageExtent.height = std::clamp<UINT32>(windowExtent.height, SwapchainSupportDetails.Capabilities.minImageExtent.height, SwapchainSupportDetails.Capabilities.maxImageExtent.height);
-    }
+    SwapchainImageExtent = GetSurfaceExtent(SwapchainSupportDetails.Capabilities);
 
-    UINT32 imageCount =
-      SwapchainSupportDetails.Capabilities.maxImageCount == 0 ?
-        SwapchainSupportDetails.Capabilities.minImageCount + 1 :
-        SwapchainSupportDetails.Capabilities.maxImageCount;
+    // every additional image is additional frame of latency, so policy count is used instead of maximal one
+    UINT32 imageCount = std::max(PresentPolicy.ImageCount, SwapchainSupportDetails.Capabilities.minImageCount);
+    if (SwapchainSupportDetails.Capabilities.maxImageCount != 0)
+      imageCount = std::min(imageCount, SwapchainSupportDetails.Capabilities.maxImageCount);
 
     // create swapchain
     VkSwapchainCreateInfoKHR CreateInfo
@@ -202,7 +192,7 @@ namespace vrt::render::core
   /* Initialize image for RT rendering to */
   VOID kernel::InitializeTarget( VOID )
   {
-    TargetImage = CreateImage(SwapchainImageExtent.width, SwapchainImageExtent.height, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    TargetImage = CreateImage(SwapchainImageExtent.width, SwapchainImageExtent.height, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
     TransferImageLayout(TargetImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL); // reset image layout
 
     VkSamplerCreateInfo SamplerCreateInfo
@@ -228,6 +218,10 @@ namespace vrt::render::core
     };
 
     utils::AssertResult(vkCreateSampler(Device, &SamplerCreateInfo, nullptr, &TargetImageSampler));
+
+    // headless target isn't post processed
+    if (!IsHeadless())
+      InitializePostImages();
   } /* InitializeTarget */
 
 
@@ -239,12 +233,12 @@ namespace vrt::render::core
       {
         .binding = 0,
         .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-        .descriptorCount = 1,
+        .descriptorCount = PostImageCount,
         .stageFlags = VK_SHADER_STAGE_ALL,
       },
       {
         .binding = 1,
-        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
         .descriptorCount = 1,
         .stageFlags = VK_SHADER_STAGE_ALL,
       }
@@ -261,20 +255,14 @@ namespace vrt::render::core
 
     utils::AssertResult(vkCreateDescriptorSetLayout(Device, &DescriptorSetLayoutCreateInfo, nullptr, &PresentDescriptorSetLayout));
 
-    VkDescriptorPoolSize DescriptorPoolSizes[]
-    {
-      {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,  1},
-      {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1},
-    };
-
     VkDescriptorPoolCreateInfo DescriptorPoolCreateInfo
     {
       .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
       .pNext = nullptr,
       .flags = 0,
       .maxSets = 1,
-      .poolSizeCount = (UINT32)std::size(DescriptorPoolSizes),
-      .pPoolSizes = DescriptorPoolSizes,
+      .poolSizeCount = (UINT32)std::size(PresentDescriptorPoolSizes),
+      .pPoolSizes = PresentDescriptorPoolSizes,
     };
 
     utils::AssertResult(vkCreateDescriptorPool(Device, &DescriptorPoolCreateInfo, nullptr, &PresentDescriptorPool));
@@ -290,33 +278,17 @@ namespace vrt::render::core
 
     utils::AssertResult(vkAllocateDescriptorSets(Device, &DescriptorSetAllocateInfo, &PresentDescriptorSet));
 
-    VkDescriptorImageInfo DescriptorImageInfo
-    {
-      .sampler = TargetImageSampler,
-      .imageView = TargetImage.ImageView,
-      .imageLayout = VK_IMAGE_LAYOUT_GENERAL
-    };
+    WritePostDescriptors();
+
     VkDescriptorBufferInfo DescriptorBufferInfo
     {
-      .buffer = PresentBuffer.Buffer,
+      .buffer = UniformRing.GetBuffer(),
       .offset = 0,
-      .range = PresentBuffer.Size,
+      .range = sizeof(present_buffer_data),
     };
 
     VkWriteDescriptorSet DescriptorSetWrites[]
     {
-      {
-        /* VkStructureType               */ .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-        /* const void*                   */ .pNext = nullptr,
-        /* VkDescriptorSet               */ .dstSet = PresentDescriptorSet,
-        /* uint32_t                      */ .dstBinding = 0,
-        /* uint32_t                      */ .dstArrayElement = 0,
-        /* uint32_t                      */ .descriptorCount = 1,
-        /* VkDescriptorType              */ .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-        /* const VkDescriptorImageInfo*  */ .pImageInfo = &DescriptorImageInfo,
-        /* const VkDescriptorBufferInfo* */ .pBufferInfo = nullptr,
-        /* const VkBufferView*           */ .pTexelBufferView = nullptr,
-      },
       {
         /* VkStructureType               */ .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
         /* const void*                   */ .pNext = nullptr,
@@ -324,7 +296,7 @@ namespace vrt::render::core
         /* uint32_t                      */ .dstBinding = 1,
         /* uint32_t                      */ .dstArrayElement = 0,
         /* uint32_t                      */ .descriptorCount = 1,
-        /* VkDescriptorType              */ .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        /* VkDescriptorType              */ .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
         /* const VkDescriptorImageInfo*  */ .pImageInfo = nullptr,
         /* const VkDescriptorBufferInfo* */ .pBufferInfo = &DescriptorBufferInfo,
         /* const VkBufferView*           */ .pTexelBufferView = nullptr,
@@ -493,29 +465,66 @@ namespace vrt::render::core
 
     utils::AssertResult(vkCreateGraphicsPipelines(Device, VK_NULL_HANDLE, 1, &GraphicsPipelineCreateInfo, nullptr, &PresentPipeline));
 
+    // post processing shares presentation descriptor set
+    VkComputePipelineCreateInfo ComputePipelineCreateInfo
+    {
+      /* VkStructureType                 */ .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+      /* const void*                     */ .pNext = nullptr,
+      /* VkPipelineCreateFlags           */ .flags = 0,
+      /* VkPipelineShaderStageCreateInfo */ .stage = VkPipelineShaderStageCreateInfo
+      {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+        .module = Shader.Compute,
+        .pName = shader::GetModuleTypeEntryPointName(shader::module_type::COMPUTE),
+        .pSpecializationInfo = nullptr,
+      },
+      /* VkPipelineLayout                */ .layout = PresentPipelineLayout,
+      /* VkPipeline                      */ .basePipelineHandle = VK_NULL_HANDLE,
+      /* int32_t                         */ .basePipelineIndex = 0,
+    };
+
+    utils::AssertResult(vkCreateComputePipelines(Device, VK_NULL_HANDLE, 1, &ComputePipelineCreateInfo, nullptr, &PostPipeline));
+
     Destroy(Shader);
   } /* InitializePresentPipeline */
 
   VOID kernel::Resize( VOID )
   {
-    vkDeviceWaitIdle(Device);
-
-
-    for (VkFramebuffer Framebuffer : Framebuffers)
-      vkDestroyFramebuffer(Device, Framebuffer, nullptr);
-    for (VkImageView ImageView : SwapchainImageViews)
-      vkDestroyImageView(Device, ImageView, nullptr);
-
-    VkSwapchainKHR OldSwapchain = Swapchain;
+    // old swapchain objects may be used by frames in flight, so they are retired instead of waiting for device
+    Retire([this, OldFramebuffers = std::move(Framebuffers), OldImageViews = std::move(SwapchainImageViews), OldSwapchain = Swapchain]( VOID )
+    {
+      for (VkFramebuffer Framebuffer : OldFramebuffers)
+        vkDestroyFramebuffer(Device, Framebuffer, nullptr);
+      for (VkImageView ImageView : OldImageViews)
+        vkDestroyImageView(Device, ImageView, nullptr);
+      vkDestroySwapchainKHR(Device, OldSwapchain, nullptr);
+    });
 
+    // old swapchain is passed to new one
     InitializeSwapchain();
     InitializeFramebuffers();
 
-    Destroy(TargetImage);
-    TargetImage = CreateImage(SwapchainImageExtent.width, SwapchainImageExtent.height, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    // frame commands are re-recorded by each frame data after its fence is waited
+    InvalidateFrameCommands();
+
+    Retire(TargetImage);
+    TargetImage = CreateImage(SwapchainImageExtent.width, SwapchainImageExtent.height, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
     TransferImageLayout(TargetImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL); // reset image layout
 
-    vkDestroySwapchainKHR(Device, OldSwapchain, nullptr);
+    // accumulation restarts in new target
+    CollectionFrameCount = 0;
+
+    for (image &PostImage : PostImages)
+      Retire(PostImage);
+    InitializePostImages();
+
+    // sets may be bound by frames in flight, so images are written to new ones
+    ReplaceDescriptorSet(PresentDescriptorPool, PresentDescriptorSet, PresentDescriptorSetLayout, PresentDescriptorPoolSizes);
+    WritePostDescriptors();
+    ReplaceDescriptorSet(Scene->DescriptorPool, Scene->DescriptorSet, Scene->DescriptorSetLayout, SceneDescriptorPoolSizes);
 
     VkDescriptorImageInfo DescriptorImageInfo
     {
@@ -538,13 +547,303 @@ namespace vrt::render::core
       /* const VkBufferView*           */ .pTexelBufferView = 0,
     };
 
-    RewriteTargetImage.dstSet = PresentDescriptorSet;
-    vkUpdateDescriptorSets(Device, 1, &RewriteTargetImage, 0, nullptr);
-
-
     // Rewrite scene descriptor sets
     RewriteTargetImage.dstSet = Scene->DescriptorSet;
     vkUpdateDescriptorSets(Device, 1, &RewriteTargetImage, 0, nullptr);
     Scene->Camera.SetAspect((FLOAT)SwapchainImageExtent.width, (FLOAT)SwapchainImageExtent.height);
   } /* Resize */
+
+  BOOL kernel::UpdateSwapchain( VOID )
+  {
+    VkSurfaceCapabilitiesKHR Capabilities;
+    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(PhysicalDevice, Surface, &Capabilities);
+
+    VkExtent2D Extent = GetSurfaceExtent(Capabilities);
+
+    // minimized window - swapchain can't be created, request is kept
+    IsSurfaceEmpty = Extent.width == 0 || Extent.height == 0;
+    if (IsSurfaceEmpty)
+      return FALSE;
+
+    if (IsSwapchainOutdated || Extent.width != SwapchainImageExtent.width || Extent.height != SwapchainImageExtent.height)
+      Resize();
+
+    IsSwapchainOutdated = FALSE;
+    IsResizeRequested = FALSE;
+    return TRUE;
+  } /* UpdateSwapchain */
+
+  VkExtent2D kernel::GetSurfaceExtent( const VkSurfaceCapabilitiesKHR &Capabilities )
+  {
+    if (Capabilities.currentExtent.width != UINT32_MAX)
+      return Capabilities.currentExtent;
+
+    struct
+    {
+      INT width, height;
+    } windowExtent;
+
+    SDL_GetWindowSize(Window, &windowExtent.width, &windowExtent.height);
+
+    return VkExtent2D
+    {
+      std::clamp<UINT32>(windowExtent.width, Capabilities.minImageExtent.width, Capabilities.maxImageExtent.width),
+      std::clamp<UINT32>(windowExtent.height, Capabilities.minImageExtent.height, Capabilities.maxImageExtent.height),
+    };
+  } /* GetSurfaceExtent */
+
+  VOID kernel::ReplaceDescriptorSet( VkDescriptorPool &Pool, VkDescriptorSet &Set, VkDescriptorSetLayout Layout, std::span<const VkDescriptorPoolSize> PoolSizes )
+  {
+    VkDescriptorPoolCreateInfo DescriptorPoolCreateInfo
+    {
+      /* VkStructureType             */ .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+      /* const void*                 */ .pNext = nullptr,
+      /* VkDescriptorPoolCreateFlags */ .flags = 0,
+      /* uint32_t                    */ .maxSets = 1,
+      /* uint32_t                    */ .poolSizeCount = (UINT32)PoolSizes.size(),
+      /* const VkDescriptorPoolSize* */ .pPoolSizes = PoolSizes.data(),
+    };
+
+    VkDescriptorPool NewPool = VK_NULL_HANDLE;
+    utils::AssertResult(vkCreateDescriptorPool(Device, &DescriptorPoolCreateInfo, nullptr, &NewPool), "error creating descriptor pool.");
+
+    VkDescriptorSetAllocateInfo DescriptorSetAllocateInfo
+    {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+      .pNext = nullptr,
+      .descriptorPool = NewPool,
+      .descriptorSetCount = 1,
+      .pSetLayouts = &Layout,
+    };
+
+    VkDescriptorSet NewSet = VK_NULL_HANDLE;
+    utils::AssertResult(vkAllocateDescriptorSets(Device, &DescriptorSetAllocateInfo, &NewSet));
+
+    // copying from set bound by pending commands is allowed, writing to it isn't
+    std::vector<VkCopyDescriptorSet> Copies;
+    Copies.reserve(PoolSizes.size());
+    for (UINT32 Binding = 0; Binding < PoolSizes.size(); Binding++)
+      Copies.push_back(VkCopyDescriptorSet
+      {
+        /* VkStructureType */ .sType = VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET,
+        /* const void*     */ .pNext = nullptr,
+        /* VkDescriptorSet */ .srcSet = Set,
+        /* uint32_t        */ .srcBinding = Binding,
+        /* uint32_t        */ .srcArrayElement = 0,
+        /* VkDescriptorSet */ .dstSet = NewSet,
+        /* uint32_t        */ .dstBinding = Binding,
+        /* uint32_t        */ .dstArrayElement = 0,
+        /* uint32_t        */ .descriptorCount = PoolSizes[Binding].descriptorCount,
+      });
+
+    vkUpdateDescriptorSets(Device, 0, nullptr, (UINT32)Copies.size(), Copies.data());
+
+    Retire([this, OldPool = Pool]( VOID )
+    {
+      vkDestroyDescriptorPool(Device, OldPool, nullptr);
+    });
+
+    Pool = NewPool;
+    Set = NewSet;
+  } /* ReplaceDescriptorSet */
+
+  VOID kernel::ResponseLatency( VOID )
+  {
+    if (LatencyTimer == nullptr)
+      return;
+
+    // presentation is queued right after frame fence is signaled, which is detected by polling once per frame, so samples are accurate up to frame time
+    for (frame &Frame : Frames)
+      if (!std::isnan(Frame.InputTime) && vkGetFenceStatus(Device, Frame.InFlightFence) == VK_SUCCESS)
+      {
+        LatencyTimer->ResponseLatency(Frame.InputTime);
+        Frame.InputTime = NAN;
+      }
+  } /* ResponseLatency */
+
+  VOID kernel::RecordFrameCommands( frame_commands &Commands, UINT32 ImageIndex, UINT32 FrameSlot, UINT32 GlobalBufferOffset, UINT32 PresentBufferOffset )
+  {
+    VkDeviceAddress SBTAddress = Scene->SBTStorageBuffer.GetDeviceAddress();
+
+    // Drawing image to target
+    VkClearValue ClearValue { 0.0f, 1.0f, 0.0f, 1.0f };
+
+    VkRenderPassBeginInfo PresentBeginInfo
+    {
+      /* VkStructureType     */ .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+      /* const void*         */ .pNext = nullptr,
+      /* VkRenderPass        */ .renderPass = PresentRenderPass,
+      /* VkFramebuffer       */ .framebuffer = IsHeadless() ? VK_NULL_HANDLE : Framebuffers[ImageIndex],
+      /* VkRect2D            */ .renderArea = { 0, 0, SwapchainImageExtent.width, SwapchainImageExtent.height },
+      /* uint32_t            */ .clearValueCount = 1,
+      /* const VkClearValue* */ .pClearValues = &ClearValue,
+    };
+
+    // passes are recorded by worker threads and executed in this order
+    recording_scheduler::pass Passes[]
+    {
+      // raytracing
+      {
+        .Record = [&]( VkCommandBuffer CommandBuffer )
+        {
+          // previous frame may still copy target image to post image or write it in raytracing shaders
+          VkMemoryBarrier TargetImageBarrier
+          {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+          };
+
+          vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, 0, 1, &TargetImageBarrier, 0, nullptr, 0, nullptr);
+
+          vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, Scene->Pipeline);
+          vkCmdBindDescriptorSets(CommandBuffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, Scene->PipelineLayout, 0, 1, &Scene->DescriptorSet, 1, &GlobalBufferOffset);
+
+          VkStridedDeviceAddressRegionKHR RayGenRegion
+          {
+            .deviceAddress = SBTAddress + Scene->SBTAlignedGroupSize * 0,
+            .stride = Scene->SBTAlignedGroupSize,
+            .size = Scene->SBTAlignedGroupSize,
+          };
+          VkStridedDeviceAddressRegionKHR MissRegion
+          {
+            .deviceAddress = SBTAddress + Scene->SBTAlignedGroupSize * 1,
+            .stride = Scene->SBTAlignedGroupSize,
+            .size = Scene->SBTAlignedGroupSize,
+          };
+          VkStridedDeviceAddressRegionKHR HitRegion
+          {
+            .deviceAddress = SBTAddress + Scene->SBTAlignedGroupSize * 2,
+            .stride = Scene->SBTAlignedGroupSize,
+            .size = Scene->SBTAlignedGroupSize * Scene->HitShaderGroupCount,
+          };
+
+          VkStridedDeviceAddressRegionKHR CallableRegion {};
+
+          vkCmdTraceRaysKHR
+          (
+            CommandBuffer,
+            &RayGenRegion,
+            &MissRegion,
+            &HitRegion,
+            &CallableRegion,
+            SwapchainImageExtent.width, SwapchainImageExtent.height, 1
+          );
+
+          VkMemoryBarrier MemoryBarrier
+          {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+          };
+
+          /* 'end raytracing subpass' - target image is copied to post image by frame post commands */
+          vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &MemoryBarrier, 0, nullptr, 0, nullptr);
+        },
+      },
+
+      // presentation
+      {
+        .Record = [&]( VkCommandBuffer CommandBuffer )
+        {
+          vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, PresentPipeline);
+
+          VkViewport Viewport { 0, 0, (FLOAT)SwapchainImageExtent.width, (FLOAT)SwapchainImageExtent.height, 0.0f, 1.0f };
+          vkCmdSetViewport(CommandBuffer, 0, 1, &Viewport);
+          VkRect2D Scissor { {0, 0}, SwapchainImageExtent };
+          vkCmdSetScissor(CommandBuffer, 0, 1, &Scissor);
+          vkCmdBindDescriptorSets(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, PresentPipelineLayout, 0, 1, &PresentDescriptorSet, 1, &PresentBufferOffset);
+          vkCmdDraw(CommandBuffer, 4, 1, 0, 0);
+        },
+        .RenderPassBeginInfo = &PresentBeginInfo,
+      },
+    };
+
+    // headless frame doesn't present
+    std::span<const recording_scheduler::pass> PassSpan {Passes};
+    if (IsHeadless())
+      PassSpan = PassSpan.first(1);
+
+    RecordingScheduler.Record(PassSpan, FrameSlot, Commands.PassCommandBuffers);
+
+    VkCommandBufferBeginInfo CommandBufferBeginInfo
+    {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .pInheritanceInfo = nullptr,
+    };
+
+    // raytracing and presentation are submitted separately: post processing runs between them on compute queue
+    std::span<const VkCommandBuffer> PassCommandBuffers {Commands.PassCommandBuffers};
+
+    vkBeginCommandBuffer(Commands.CommandBuffer, &CommandBufferBeginInfo);
+    RecordingScheduler.Execute(Commands.CommandBuffer, PassSpan.first(1), PassCommandBuffers.first(1));
+    vkEndCommandBuffer(Commands.CommandBuffer);
+
+    if (IsHeadless())
+      return;
+
+    vkBeginCommandBuffer(Commands.PresentCommandBuffer, &CommandBufferBeginInfo);
+    RecordingScheduler.Execute(Commands.PresentCommandBuffer, PassSpan.subspan(1), PassCommandBuffers.subspan(1));
+    vkEndCommandBuffer(Commands.PresentCommandBuffer);
+  } /* RecordFrameCommands */
+
+  kernel::frame_commands & kernel::GetFrameCommands( UINT32 ImageIndex, UINT32 FrameSlot, UINT32 GlobalBufferOffset, UINT32 PresentBufferOffset )
+  {
+    if (FrameCommandsScene != Scene)
+    {
+      InvalidateFrameCommands();
+      FrameCommandsScene = Scene;
+    }
+
+    // headless frames use one set of commands per frame data
+    SIZE_T ImageCount = std::max<SIZE_T>(SwapchainImages.size(), 1);
+
+    if (FrameCommands.size() < ImageCount * MaxFramesInFlight)
+      FrameCommands.resize(ImageCount * MaxFramesInFlight);
+
+    // commands of same frame data index are never used by device simultaneously - its fence is waited
+    frame_commands &Commands = FrameCommands[ImageIndex * MaxFramesInFlight + FrameSlot];
+
+    if (Commands.IsValid && Commands.GlobalBufferOffset == GlobalBufferOffset && Commands.PresentBufferOffset == PresentBufferOffset)
+      return Commands;
+
+    if (Commands.CommandBuffer == VK_NULL_HANDLE)
+    {
+      Commands.CommandBuffer = CreateCommandBuffer(GraphicsCommandPool);
+      Commands.PresentCommandBuffer = CreateCommandBuffer(GraphicsCommandPool);
+    }
+
+    RecordFrameCommands(Commands, ImageIndex, FrameSlot, GlobalBufferOffset, PresentBufferOffset);
+
+    Commands.GlobalBufferOffset = GlobalBufferOffset;
+    Commands.PresentBufferOffset = PresentBufferOffset;
+    Commands.IsValid = TRUE;
+
+    return Commands;
+  } /* GetFrameCommands */
+
+  VOID kernel::InvalidateFrameCommands( VOID )
+  {
+    for (frame_commands &Commands : FrameCommands)
+      Commands.IsValid = FALSE;
+  } /* InvalidateFrameCommands */
+
+  VOID kernel::DestroyFrameCommands( VOID )
+  {
+    for (SIZE_T i = 0; i < FrameCommands.size(); i++)
+    {
+      if (FrameCommands[i].CommandBuffer != VK_NULL_HANDLE)
+      {
+        VkCommandBuffer CommandBuffers[] {FrameCommands[i].CommandBuffer, FrameCommands[i].PresentCommandBuffer};
+        vkFreeCommandBuffers(Device, GraphicsCommandPool, (UINT32)std::size(CommandBuffers), CommandBuffers);
+      }
+      RecordingScheduler.Free(UINT32(i % MaxFramesInFlight), FrameCommands[i].PassCommandBuffers);
+    }
+
+    FrameCommands.clear();
+  } /* DestroyFrameCommands */
 } /* namespace rtt::render */
\ No newline at end of file
@@ -0,0 +1,361 @@
+#include "vrt.h"
+
+namespace vrt::render::core
+{
+  /* Accumulated target pixel to 8-bit color converting function. Post processing and sRGB encoding of presentation are repeated on host. */
+  static UINT32 ResolveTargetPixel( const vec4 &Sum, UINT32 CollectionFrameCount )
+  {
+    auto Encode = [&]( FLOAT Value ) -> UINT32
+    {
+      Value /= CollectionFrameCount;
+      Value = Value / (Value + 1.0f);
+      Value = Value <= 0.0031308f ? Value * 12.92f : 1.055f * std::pow(Value, 1.0f / 2.4f) - 0.055f;
+
+      return static_cast<UINT32>(std::clamp(Value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    };
+
+    // ABGR8888 - red is in low byte
+    return Encode(Sum.X) | (Encode(Sum.Y) << 8) | (Encode(Sum.Z) << 16) | 0xFF000000;
+  } /* ResolveTargetPixel */
+
+  /* Accumulated target copy to image resolving function */
+  static utils::image ResolveTarget( const vec4 *Data, UINT32 Width, UINT32 Height, UINT32 CollectionFrameCount )
+  {
+    UINT32 FrameCount = std::max(CollectionFrameCount, 1U);
+
+    utils::image Image;
+    Image.Width = Width;
+    Image.Height = Height;
+    Image.Pixels.resize(SIZE_T(Width) * Height);
+
+    for (SIZE_T i = 0; i < Image.Pixels.size(); i++)
+      Image.Pixels[i] = ResolveTargetPixel(Data[i], FrameCount);
+
+    return Image;
+  } /* ResolveTarget */
+
+  /* Accumulated target copy saving function. Averaged linear colors are written as portable float map. */
+  static BOOL SaveTargetPFM( const vec4 *Data, UINT32 Width, UINT32 Height, UINT32 CollectionFrameCount, const std::string &FileName )
+  {
+    std::FILE *File = std::fopen(FileName.c_str(), "wb");
+
+    if (File == nullptr)
+      return FALSE;
+
+    FLOAT Scale = 1.0f / std::max(CollectionFrameCount, 1U);
+    std::vector<FLOAT> Row(SIZE_T(Width) * 3);
+
+    // negative scale - little endian, rows are stored from bottom to top
+    std::fprintf(File, "PF\n%u %u\n-1.0\n", Width, Height);
+    for (UINT32 y = Height; y-- > 0;)
+    {
+      for (UINT32 x = 0; x < Width; x++)
+      {
+        const vec4 &Sum = Data[SIZE_T(y) * Width + x];
+
+        Row[x * 3 + 0] = Sum.X * Scale;
+        Row[x * 3 + 1] = Sum.Y * Scale;
+        Row[x * 3 + 2] = Sum.Z * Scale;
+      }
+      std::fwrite(Row.data(), sizeof(FLOAT), Row.size(), File);
+    }
+
+    return std::fclose(File) == 0;
+  } /* SaveTargetPFM */
+
+  VOID frame_encoder::Initialize( UINT32 ThreadCount, SIZE_T QueueCapacity )
+  {
+    Capacity = std::max<SIZE_T>(QueueCapacity, 1);
+    IsClosing = FALSE;
+
+    Threads.resize(std::max<UINT32>(ThreadCount, 1));
+    for (std::thread &Thread : Threads)
+      Thread = std::thread(&frame_encoder::WorkerMain, this);
+  } /* Initialize */
+
+  VOID frame_encoder::WorkerMain( VOID )
+  {
+    while (TRUE)
+    {
+      std::unique_lock<std::mutex> Lock(Mutex);
+      WorkCondition.wait(Lock, [&]( VOID ) { return IsClosing || !Queue.empty(); });
+
+      // queued frames are saved before closing
+      if (Queue.empty())
+        return;
+
+      frame Frame = std::move(Queue.front());
+      Queue.pop_front();
+      Lock.unlock();
+      SpaceCondition.notify_one();
+
+      BOOL IsSaved = FALSE;
+      if (std::filesystem::path(Frame.FileName).extension() == ".pfm")
+        IsSaved = SaveTargetPFM(Frame.Data.data(), Frame.Width, Frame.Height, Frame.CollectionFrameCount, Frame.FileName);
+      else
+        IsSaved = ResolveTarget(Frame.Data.data(), Frame.Width, Frame.Height, Frame.CollectionFrameCount).Save(Frame.FileName);
+
+      if (!IsSaved)
+        std::cerr << std::format("encoder: can't save '{}'.\n", Frame.FileName);
+    }
+  } /* WorkerMain */
+
+  VOID frame_encoder::Push( frame &&Frame )
+  {
+    {
+      std::unique_lock<std::mutex> Lock(Mutex);
+      SpaceCondition.wait(Lock, [&]( VOID ) { return Queue.size() < Capacity; });
+      Queue.push_back(std::move(Frame));
+    }
+    WorkCondition.notify_one();
+  } /* Push */
+
+  VOID frame_encoder::Close( VOID )
+  {
+    {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      IsClosing = TRUE;
+    }
+    WorkCondition.notify_all();
+
+    for (std::thread &Thread : Threads)
+      if (Thread.joinable())
+        Thread.join();
+    Threads.clear();
+  } /* Close */
+
+  /* Target image to buffer copy recording function. Copy waits for raytracing and is made visible to host. */
+  static VOID RecordTargetCopy( VkCommandBuffer CommandBuffer, VkImage Image, VkBuffer Buffer, UINT32 Width, UINT32 Height )
+  {
+    VkMemoryBarrier TraceBarrier
+    {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .pNext = nullptr,
+      .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+    };
+
+    vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &TraceBarrier, 0, nullptr, 0, nullptr);
+
+    VkBufferImageCopy Region
+    {
+      /* VkDeviceSize             */ .bufferOffset = 0,
+      /* uint32_t                 */ .bufferRowLength = 0,
+      /* uint32_t                 */ .bufferImageHeight = 0,
+      /* VkImageSubresourceLayers */ .imageSubresource = VkImageSubresourceLayers
+      {
+        /* VkImageAspectFlags */ .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        /* uint32_t           */ .mipLevel = 0,
+        /* uint32_t           */ .baseArrayLayer = 0,
+        /* uint32_t           */ .layerCount = 1,
+      },
+      /* VkOffset3D               */ .imageOffset = {0, 0, 0},
+      /* VkExtent3D               */ .imageExtent = {Width, Height, 1},
+    };
+
+    vkCmdCopyImageToBuffer(CommandBuffer, Image, VK_IMAGE_LAYOUT_GENERAL, Buffer, 1, &Region);
+
+    VkMemoryBarrier HostBarrier
+    {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .pNext = nullptr,
+      .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+    };
+
+    vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &HostBarrier, 0, nullptr, 0, nullptr);
+  } /* RecordTargetCopy */
+
+  VOID readback_ring::Initialize( kernel *NewKernel, frame_encoder *NewEncoder, UINT32 SlotCount )
+  {
+    Kernel = NewKernel;
+    Encoder = NewEncoder;
+    IsClosing = FALSE;
+
+    VkFenceCreateInfo FenceCreateInfo
+    {
+      .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+    };
+
+    // slots are created before worker starts, so vector is never resized while it runs
+    Slots.resize(std::max<UINT32>(SlotCount, 1));
+    for (slot &Slot : Slots)
+    {
+      Slot.CommandBuffer = Kernel->CreateCommandBuffer(Kernel->GraphicsCommandPool);
+      utils::AssertResult(vkCreateFence(Kernel->Device, &FenceCreateInfo, nullptr, &Slot.Fence), "error creating readback fence");
+    }
+
+    Worker = std::thread(&readback_ring::WorkerMain, this);
+  } /* Initialize */
+
+  VOID readback_ring::WorkerMain( VOID )
+  {
+    while (TRUE)
+    {
+      std::unique_lock<std::mutex> Lock(Mutex);
+      WorkCondition.wait(Lock, [&]( VOID ) { return IsClosing || !Pending.empty(); });
+
+      // submitted copies are saved before closing
+      if (Pending.empty())
+        return;
+
+      slot &Slot = Slots[Pending.front()];
+      Pending.pop_front();
+      Lock.unlock();
+
+      // only worker uses busy slot, so its fence is waited and reset without locking
+      utils::AssertResult(vkWaitForFences(Kernel->Device, 1, &Slot.Fence, VK_TRUE, UINT64_MAX), "error waiting for readback");
+      vkResetFences(Kernel->Device, 1, &Slot.Fence);
+
+      // copy is taken out of slot, so slot is reused while frame is encoded
+      const vec4 *Data = reinterpret_cast<const vec4 *>(Slot.Buffer.MapMemory());
+
+      frame_encoder::frame Frame
+      {
+        .Data = std::vector<vec4>(Data, Data + SIZE_T(Slot.Width) * Slot.Height),
+        .Width = Slot.Width,
+        .Height = Slot.Height,
+        .CollectionFrameCount = Slot.CollectionFrameCount,
+        .FileName = std::move(Slot.FileName),
+      };
+
+      Lock.lock();
+      Slot.IsBusy = FALSE;
+      Lock.unlock();
+
+      // full encoder queue blocks this thread only - render thread sees busy slots and keeps rendering
+      Encoder->Push(std::move(Frame));
+    }
+  } /* WorkerMain */
+
+  VOID readback_ring::Request( std::string_view FileName )
+  {
+    Requests.push_back(std::string(FileName));
+  } /* Request */
+
+  BOOL readback_ring::IsAvailable( VOID )
+  {
+    if (!Requests.empty())
+      return FALSE;
+
+    std::lock_guard<std::mutex> Lock(Mutex);
+
+    for (const slot &Slot : Slots)
+      if (!Slot.IsBusy)
+        return TRUE;
+    return FALSE;
+  } /* IsAvailable */
+
+  VOID readback_ring::Submit( const image &Image, VkExtent2D Extent, UINT32 CollectionFrameCount )
+  {
+    if (Requests.empty())
+      return;
+
+    slot *Slot = nullptr;
+    {
+      std::lock_guard<std::mutex> Lock(Mutex);
+
+      for (slot &Candidate : Slots)
+        if (!Candidate.IsBusy)
+        {
+          Slot = &Candidate;
+          break;
+        }
+    }
+
+    // all slots are being saved - request is kept for next frame instead of waiting for worker
+    if (Slot == nullptr)
+      return;
+
+    // free slot isn't used by device, so smaller buffer is replaced immediately
+    VkDeviceSize Size = VkDeviceSize(Extent.width) * Extent.height * sizeof(vec4);
+    if (Slot->Buffer.Size < Size)
+    {
+      if (Slot->Buffer.Buffer != VK_NULL_HANDLE)
+        Kernel->Destroy(Slot->Buffer);
+      Slot->Buffer = Kernel->CreateBuffer(Size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+    }
+
+    Slot->Width = Extent.width;
+    Slot->Height = Extent.height;
+    Slot->CollectionFrameCount = CollectionFrameCount;
+    Slot->FileName = std::move(Requests.front());
+    Requests.pop_front();
+
+    VkCommandBufferBeginInfo BeginInfo
+    {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      .pNext = nullptr,
+      .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+      .pInheritanceInfo = nullptr,
+    };
+
+    vkBeginCommandBuffer(Slot->CommandBuffer, &BeginInfo);
+    RecordTargetCopy(Slot->CommandBuffer, Image.Image, Slot->Buffer.Buffer, Extent.width, Extent.height);
+    vkEndCommandBuffer(Slot->CommandBuffer);
+
+    VkSubmitInfo SubmitInfo
+    {
+      .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+      .pNext = nullptr,
+      .waitSemaphoreCount = 0,
+      .pWaitSemaphores = nullptr,
+      .pWaitDstStageMask = nullptr,
+      .commandBufferCount = 1,
+      .pCommandBuffers = &Slot->CommandBuffer,
+      .signalSemaphoreCount = 0,
+      .pSignalSemaphores = nullptr,
+    };
+
+    {
+      std::lock_guard<std::recursive_mutex> SubmitLock(Kernel->SubmitMutex);
+      utils::AssertResult(vkQueueSubmit(Kernel->GraphicsQueue, 1, &SubmitInfo, Slot->Fence), "can't submit readback command buffer");
+    }
+
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Slot->IsBusy = TRUE;
+    Pending.push_back(UINT32(Slot - Slots.data()));
+    WorkCondition.notify_one();
+  } /* Submit */
+
+  VOID readback_ring::Close( VOID )
+  {
+    {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      IsClosing = TRUE;
+    }
+    WorkCondition.notify_one();
+
+    if (Worker.joinable())
+      Worker.join();
+
+    for (slot &Slot : Slots)
+    {
+      if (Slot.Buffer.Buffer != VK_NULL_HANDLE)
+        Kernel->Destroy(Slot.Buffer);
+      vkFreeCommandBuffers(Kernel->Device, Kernel->GraphicsCommandPool, 1, &Slot.CommandBuffer);
+      vkDestroyFence(Kernel->Device, Slot.Fence, nullptr);
+    }
+    Slots.clear();
+    Requests.clear();
+  } /* Close */
+
+  BOOL kernel::SaveTarget( std::string_view FileName )
+  {
+    const UINT32 Width = SwapchainImageExtent.width, Height = SwapchainImageExtent.height;
+
+    buffer ReadbackBuffer = CreateBuffer(SIZE_T(Width) * Height * sizeof(vec4), VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+
+    // target image is owned by graphics queue, so it is copied by single time commands after all submitted frames
+    VkCommandBuffer CommandBuffer = BeginSingleTimeCommands();
+    RecordTargetCopy(CommandBuffer, TargetImage.Image, ReadbackBuffer.Buffer, Width, Height);
+    EndSingleTimeCommands(CommandBuffer);
+
+    utils::image Image = ResolveTarget(reinterpret_cast<const vec4 *>(ReadbackBuffer.MapMemory()), Width, Height, CollectionFrameCount);
+    Destroy(ReadbackBuffer);
+
+    return Image.Save(FileName);
+  } /* SaveTarget */
+} /* namespace vrt::render::core */
@@ -0,0 +1,173 @@
+#include "vrt.h"
+
+namespace vrt::render::core
+{
+  VOID recording_scheduler::Initialize( kernel *NewKernel, UINT32 WorkerCount, UINT32 FrameCount )
+  {
+    Kernel = NewKernel;
+    IsClosing = FALSE;
+    JobGeneration = 0;
+    ActiveWorkerCount = 0;
+
+    VkCommandPoolCreateInfo CreateInfo
+    {
+      /* VkStructureType          */ .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+      /* const void*              */ .pNext = nullptr,
+      /* VkCommandPoolCreateFlags */ .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+      /* uint32_t                 */ .queueFamilyIndex = Kernel->QueueFamilies.Graphics,
+    };
+
+    // pools are created before threads start, so workers vector is never resized while they run
+    Workers.resize(std::max<UINT32>(WorkerCount, 1));
+    for (worker &Worker : Workers)
+    {
+      Worker.CommandPools.resize(FrameCount);
+      for (VkCommandPool &CommandPool : Worker.CommandPools)
+        utils::AssertResult(vkCreateCommandPool(Kernel->Device, &CreateInfo, nullptr, &CommandPool), "error creating recording command pool");
+    }
+
+    for (UINT32 i = 0; i < Workers.size(); i++)
+      Workers[i].Thread = std::thread(&recording_scheduler::WorkerMain, this, i);
+  } /* Initialize */
+
+  VOID recording_scheduler::WorkerMain( UINT32 WorkerIndex )
+  {
+    UINT64 Generation = 0;
+
+    while (TRUE)
+    {
+      std::unique_lock<std::mutex> Lock(Mutex);
+      WorkCondition.wait(Lock, [&]( VOID ) { return IsClosing || JobGeneration != Generation; });
+
+      if (IsClosing)
+        return;
+
+      Generation = JobGeneration;
+      Lock.unlock();
+
+      // passes are distributed round-robin, so command buffer of pass always belongs to pool of same worker
+      for (SIZE_T PassIndex = WorkerIndex; PassIndex < JobPasses.size(); PassIndex += Workers.size())
+        RecordPass(WorkerIndex, PassIndex);
+
+      Lock.lock();
+      if (--ActiveWorkerCount == 0)
+        DoneCondition.notify_one();
+    }
+  } /* WorkerMain */
+
+  VOID recording_scheduler::RecordPass( UINT32 WorkerIndex, SIZE_T PassIndex )
+  {
+    const pass &Pass = JobPasses[PassIndex];
+    VkCommandBuffer &CommandBuffer = JobCommandBuffers[PassIndex];
+
+    if (CommandBuffer == VK_NULL_HANDLE)
+      CommandBuffer = Kernel->CreateCommandBuffer(Workers[WorkerIndex].CommandPools[JobFrameSlot], VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
+    VkCommandBufferInheritanceInfo InheritanceInfo
+    {
+      /* VkStructureType               */ .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+      /* const void*                   */ .pNext = nullptr,
+      /* VkRenderPass                  */ .renderPass = Pass.RenderPassBeginInfo != nullptr ? Pass.RenderPassBeginInfo->renderPass : VK_NULL_HANDLE,
+      /* uint32_t                      */ .subpass = 0,
+      /* VkFramebuffer                 */ .framebuffer = Pass.RenderPassBeginInfo != nullptr ? Pass.RenderPassBeginInfo->framebuffer : VK_NULL_HANDLE,
+      /* VkBool32                      */ .occlusionQueryEnable = VK_FALSE,
+      /* VkQueryControlFlags           */ .queryFlags = 0,
+      /* VkQueryPipelineStatisticFlags */ .pipelineStatistics = 0,
+    };
+
+    VkCommandBufferBeginInfo BeginInfo
+    {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      .pNext = nullptr,
+      .flags = Pass.RenderPassBeginInfo != nullptr ? (VkCommandBufferUsageFlags)VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT : 0U,
+      .pInheritanceInfo = &InheritanceInfo,
+    };
+
+    vkBeginCommandBuffer(CommandBuffer, &BeginInfo);
+    Pass.Record(CommandBuffer);
+    vkEndCommandBuffer(CommandBuffer);
+  } /* RecordPass */
+
+  VOID recording_scheduler::Record( std::span<const pass> Passes, UINT32 FrameSlot, std::vector<VkCommandBuffer> &CommandBuffers )
+  {
+    // workers are idle, so their pools can be used by this thread
+    if (CommandBuffers.size() > Passes.size())
+    {
+      std::vector<VkCommandBuffer> Extra {CommandBuffers.begin() + Passes.size(), CommandBuffers.end()};
+
+      for (SIZE_T i = 0; i < Extra.size(); i++)
+        if (Extra[i] != VK_NULL_HANDLE)
+          vkFreeCommandBuffers(Kernel->Device, Workers[(Passes.size() + i) % Workers.size()].CommandPools[FrameSlot], 1, &Extra[i]);
+    }
+    CommandBuffers.resize(Passes.size(), VK_NULL_HANDLE);
+
+    if (Passes.empty())
+      return;
+
+    std::unique_lock<std::mutex> Lock(Mutex);
+
+    JobPasses = Passes;
+    JobFrameSlot = FrameSlot;
+    JobCommandBuffers = CommandBuffers.data();
+    ActiveWorkerCount = static_cast<UINT32>(Workers.size());
+    JobGeneration++;
+
+    WorkCondition.notify_all();
+    DoneCondition.wait(Lock, [&]( VOID ) { return ActiveWorkerCount == 0; });
+  } /* Record */
+
+  VOID recording_scheduler::Execute( VkCommandBuffer PrimaryCommandBuffer, std::span<const pass> Passes, std::span<const VkCommandBuffer> CommandBuffers )
+  {
+    const VkRenderPassBeginInfo *RenderPassBeginInfo = nullptr;
+    SIZE_T First = 0;
+
+    // consecutive passes of one render pass instance are executed by one call
+    for (SIZE_T i = 0; i <= Passes.size(); i++)
+    {
+      if (i != Passes.size() && Passes[i].RenderPassBeginInfo == RenderPassBeginInfo)
+        continue;
+
+      if (i != First)
+        vkCmdExecuteCommands(PrimaryCommandBuffer, static_cast<UINT32>(i - First), CommandBuffers.data() + First);
+      First = i;
+
+      if (RenderPassBeginInfo != nullptr)
+        vkCmdEndRenderPass(PrimaryCommandBuffer);
+
+      if (i == Passes.size())
+        break;
+
+      RenderPassBeginInfo = Passes[i].RenderPassBeginInfo;
+      if (RenderPassBeginInfo != nullptr)
+        vkCmdBeginRenderPass(PrimaryCommandBuffer, RenderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    }
+  } /* Execute */
+
+  VOID recording_scheduler::Free( UINT32 FrameSlot, std::vector<VkCommandBuffer> &CommandBuffers )
+  {
+    for (SIZE_T i = 0; i < CommandBuffers.size(); i++)
+      if (CommandBuffers[i] != VK_NULL_HANDLE)
+        vkFreeCommandBuffers(Kernel->Device, Workers[i % Workers.size()].CommandPools[FrameSlot], 1, &CommandBuffers[i]);
+
+    CommandBuffers.clear();
+  } /* Free */
+
+  VOID recording_scheduler::Close( VOID )
+  {
+    {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      IsClosing = TRUE;
+    }
+    WorkCondition.notify_all();
+
+    for (worker &Worker : Workers)
+    {
+      Worker.Thread.join();
+
+      for (VkCommandPool CommandPool : Worker.CommandPools)
+        vkDestroyCommandPool(Kernel->Device, CommandPool, nullptr);
+    }
+
+    Workers.clear();
+  } /* Close */
+} /* namespace vrt::render::core */
@@ -0,0 +1,81 @@
+#include "vrt.h"
+
+namespace vrt::render::core
+{
+  VOID kernel::Retire( std::function<VOID( VOID )> &&Destroy )
+  {
+    // frames [0, CurrentFrame) and all submitted transfers may use object
+    RetireQueue.push_back(retired_object
+    {
+      .Frame = CurrentFrame,
+      .TransferValue = TransferTimelineValue,
+      .Destroy = std::move(Destroy),
+    });
+  } /* Retire */
+
+  VOID kernel::Retire( buffer &Buffer )
+  {
+    if (Buffer.Buffer == VK_NULL_HANDLE)
+      return;
+
+    // buffer may be destroyed before next graphics submission
+    DiscardAcquires(Buffer.Buffer);
+
+    Retire([this, Handle = Buffer.Buffer, Allocation = Buffer.Allocation]( VOID ) mutable
+    {
+      vkDestroyBuffer(Device, Handle, nullptr);
+      MemoryAllocator.Free(Allocation);
+    });
+
+    Buffer.Buffer = VK_NULL_HANDLE;
+    Buffer.Allocation = memory_allocation {};
+  } /* Retire */
+
+  VOID kernel::Retire( image &Image )
+  {
+    if (Image.Image == VK_NULL_HANDLE)
+      return;
+
+    DiscardAcquires(Image.Image);
+
+    Retire([this, Handle = Image.Image, View = Image.ImageView, Allocation = Image.Allocation]( VOID ) mutable
+    {
+      vkDestroyImageView(Device, View, nullptr);
+      vkDestroyImage(Device, Handle, nullptr);
+      MemoryAllocator.Free(Allocation);
+    });
+
+    Image.Image = VK_NULL_HANDLE;
+    Image.ImageView = VK_NULL_HANDLE;
+    Image.Allocation = memory_allocation {};
+  } /* Retire */
+
+  VOID kernel::CollectRetired( VOID )
+  {
+    if (RetireQueue.empty())
+      return;
+
+    UINT64 TransferValue = 0;
+    vkGetSemaphoreCounterValue(Device, TransferTimeline, &TransferValue);
+
+    // queue is ordered by both frame and transfer value
+    while (!RetireQueue.empty() && RetireQueue.front().Frame <= CompletedFrameCount && RetireQueue.front().TransferValue <= TransferValue)
+    {
+      std::function<VOID( VOID )> Destroy = std::move(RetireQueue.front().Destroy);
+
+      RetireQueue.pop_front();
+      Destroy();
+    }
+  } /* CollectRetired */
+
+  VOID kernel::FlushRetired( VOID )
+  {
+    while (!RetireQueue.empty())
+    {
+      std::function<VOID( VOID )> Destroy = std::move(RetireQueue.front().Destroy);
+
+      RetireQueue.pop_front();
+      Destroy();
+    }
+  } /* FlushRetired */
+} /* namespace vrt::render::core */
@@ -0,0 +1,492 @@
+#include "vrt.h"
+
+namespace vrt::render::core
+{
+  VkSemaphore kernel::CreateTimelineSemaphore( VOID )
+  {
+    VkSemaphoreTypeCreateInfo SemaphoreTypeCreateInfo
+    {
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+      .pNext = nullptr,
+      .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+      .initialValue = 0,
+    };
+
+    VkSemaphoreCreateInfo SemaphoreCreateInfo
+    {
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+      .pNext = &SemaphoreTypeCreateInfo,
+      .flags = 0,
+    };
+
+    VkSemaphore Semaphore = VK_NULL_HANDLE;
+    utils::AssertResult(vkCreateSemaphore(Device, &SemaphoreCreateInfo, nullptr, &Semaphore), "error creating timeline semaphore");
+
+    return Semaphore;
+  } /* CreateTimelineSemaphore */
+
+  VOID kernel::InitializeTimelines( VOID )
+  {
+    TransferTimeline = CreateTimelineSemaphore();
+    TransferTimelineValue = 0;
+    GraphicsTransferWaitValue = 0;
+
+    GraphicsTimeline = CreateTimelineSemaphore();
+    GraphicsTimelineValue = 0;
+
+    TraceTimeline = CreateTimelineSemaphore();
+    PostTimeline = CreateTimelineSemaphore();
+    PostValue = 0;
+  } /* InitializeTimelines */
+
+  BOOL kernel::IsUploadComplete( upload_ticket Ticket )
+  {
+    UINT64 Value = 0;
+    vkGetSemaphoreCounterValue(Device, TransferTimeline, &Value);
+
+    return Value >= Ticket.Value;
+  } /* IsUploadComplete */
+
+  VOID kernel::WaitUpload( upload_ticket Ticket )
+  {
+    if (Ticket.Value == 0)
+      return;
+
+    VkSemaphoreWaitInfo WaitInfo
+    {
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .semaphoreCount = 1,
+      .pSemaphores = &TransferTimeline,
+      .pValues = &Ticket.Value,
+    };
+
+    utils::AssertResult(vkWaitSemaphores(Device, &WaitInfo, UINT64_MAX), "error waiting for upload");
+  } /* WaitUpload */
+
+  VOID kernel::RetireTransfers( VOID )
+  {
+    thread_command_allocators &Allocators = GetThreadCommandAllocators();
+
+    Allocators.Transfer.Recycle();
+    Allocators.Graphics.Recycle();
+  } /* RetireTransfers */
+
+  BOOL kernel::GetGraphicsTransferWait( UINT64 &WaitValue )
+  {
+    // batched writes aren't visible to device until batch is submitted
+    UploadBatch.Submit();
+
+    // queue submissions are ordered, so every graphics submission after this one is synchronized too
+    if (GraphicsTransferWaitValue == TransferTimelineValue)
+      return FALSE;
+
+    WaitValue = GraphicsTransferWaitValue = TransferTimelineValue;
+    return TRUE;
+  } /* GetGraphicsTransferWait */
+
+  VOID kernel::ReleaseToGraphics( VkCommandBuffer TransferCommandBuffer, VkBuffer Buffer, VkDeviceSize Offset, VkDeviceSize Size )
+  {
+    // same family - graphics submission wait on transfer timeline is enough
+    if (!IsOwnershipTransferRequired())
+      return;
+
+    VkBufferMemoryBarrier BufferMemoryBarrier
+    {
+      /* VkStructureType */ .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+      /* const void*     */ .pNext = nullptr,
+      /* VkAccessFlags   */ .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      /* VkAccessFlags   */ .dstAccessMask = 0,
+      /* uint32_t        */ .srcQueueFamilyIndex = QueueFamilies.Transfer,
+      /* uint32_t        */ .dstQueueFamilyIndex = QueueFamilies.Graphics,
+      /* VkBuffer        */ .buffer = Buffer,
+      /* VkDeviceSize    */ .offset = Offset,
+      /* VkDeviceSize    */ .size = Size,
+    };
+
+    vkCmdPipelineBarrier(TransferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &BufferMemoryBarrier, 0, nullptr);
+
+    BufferMemoryBarrier.srcAccessMask = 0;
+    BufferMemoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+    std::lock_guard<std::recursive_mutex> Lock(SubmitMutex);
+    PendingBufferAcquires.push_back(BufferMemoryBarrier);
+  } /* ReleaseToGraphics */
+
+  VOID kernel::ReleaseToGraphics( VkCommandBuffer TransferCommandBuffer, VkImageMemoryBarrier Barrier, VkPipelineStageFlags SourceStageFlags )
+  {
+    Barrier.dstAccessMask = 0;
+
+    // same family - barrier only transitions layout
+    if (!IsOwnershipTransferRequired())
+    {
+      Barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      Barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      vkCmdPipelineBarrier(TransferCommandBuffer, SourceStageFlags, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &Barrier);
+      return;
+    }
+
+    Barrier.srcQueueFamilyIndex = QueueFamilies.Transfer;
+    Barrier.dstQueueFamilyIndex = QueueFamilies.Graphics;
+    vkCmdPipelineBarrier(TransferCommandBuffer, SourceStageFlags, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &Barrier);
+
+    // acquire repeats layout transition of release
+    Barrier.srcAccessMask = 0;
+    Barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+    std::lock_guard<std::recursive_mutex> Lock(SubmitMutex);
+    PendingImageAcquires.push_back(Barrier);
+  } /* ReleaseToGraphics */
+
+  VOID kernel::RecordAcquires( VkCommandBuffer GraphicsCommandBuffer )
+  {
+    std::lock_guard<std::recursive_mutex> Lock(SubmitMutex);
+
+    if (!IsAcquirePending())
+      return;
+
+    // releases are finished before transfer timeline wait of submission is satisfied
+    vkCmdPipelineBarrier
+    (
+      GraphicsCommandBuffer,
+      VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+      0, nullptr,
+      static_cast<UINT32>(PendingBufferAcquires.size()), PendingBufferAcquires.data(),
+      static_cast<UINT32>(PendingImageAcquires.size()), PendingImageAcquires.data()
+    );
+
+    PendingBufferAcquires.clear();
+    PendingImageAcquires.clear();
+  } /* RecordAcquires */
+
+  VOID kernel::DiscardAcquires( VkBuffer Buffer )
+  {
+    std::erase_if(PendingBufferAcquires, [Buffer]( const VkBufferMemoryBarrier &Barrier ) { return Barrier.buffer == Buffer; });
+  } /* DiscardAcquires */
+
+  VOID kernel::DiscardAcquires( VkImage Image )
+  {
+    std::erase_if(PendingImageAcquires, [Image]( const VkImageMemoryBarrier &Barrier ) { return Barrier.image == Image; });
+  } /* DiscardAcquires */
+
+  VOID kernel::CloseTimelines( VOID )
+  {
+    WaitUpload(upload_ticket {TransferTimelineValue});
+    RetireTransfers();
+
+    vkDestroySemaphore(Device, TransferTimeline, nullptr);
+    vkDestroySemaphore(Device, GraphicsTimeline, nullptr);
+    vkDestroySemaphore(Device, TraceTimeline, nullptr);
+    vkDestroySemaphore(Device, PostTimeline, nullptr);
+  } /* CloseTimelines */
+
+  VOID staging_ring::Initialize( kernel *NewKernel, VkDeviceSize NewCapacity )
+  {
+    Kernel = NewKernel;
+    Capacity = NewCapacity;
+    Head = 0;
+    Tail = 0;
+    Committed = 0;
+
+    Buffer = Kernel->CreateBuffer(Capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    Data = reinterpret_cast<BYTE *>(Buffer.MapMemory());
+  } /* Initialize */
+
+  VOID staging_ring::RetireOldest( VOID )
+  {
+    VkSemaphoreWaitInfo WaitInfo
+    {
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .semaphoreCount = 1,
+      .pSemaphores = &InFlight.front().Timeline,
+      .pValues = &InFlight.front().Value,
+    };
+
+    utils::AssertResult(vkWaitSemaphores(Kernel->Device, &WaitInfo, UINT64_MAX), "error waiting for staged data copies");
+
+    Tail = InFlight.front().End;
+    InFlight.pop_front();
+  } /* RetireOldest */
+
+  VOID staging_ring::Retire( VOID )
+  {
+    // copies of different timelines are retired in commit order, so later space is never released before earlier one
+    while (!InFlight.empty())
+    {
+      UINT64 Value = 0;
+      vkGetSemaphoreCounterValue(Kernel->Device, InFlight.front().Timeline, &Value);
+      if (Value < InFlight.front().Value)
+        break;
+      RetireOldest();
+    }
+  } /* Retire */
+
+  VOID staging_ring::Flush( VOID )
+  {
+    while (!InFlight.empty())
+      RetireOldest();
+  } /* Flush */
+
+  VkDeviceSize staging_ring::Reserve( VkDeviceSize Size )
+  {
+    VkDeviceSize Start = utils::Align(Head, 16);
+
+    // upload data must be contiguous, so ring end is skipped if data doesn't fit in it
+    if (Start % Capacity + Size > Capacity)
+      Start += Capacity - Start % Capacity;
+
+    while (Start + Size - Tail > Capacity)
+    {
+      if (InFlight.empty())
+      {
+        // space is occupied by staged data, which can't be waited for until it is committed
+        if (Committed != Head)
+          return InvalidOffset;
+
+        // nothing is in flight - whole ring is free
+        Tail = Start;
+        break;
+      }
+
+      RetireOldest();
+    }
+
+    Head = Start + Size;
+
+    return Start % Capacity;
+  } /* Reserve */
+
+  upload_ticket staging_ring::Upload( buffer &Destination, VkDeviceSize DestinationOffset, const VOID *SourceData, VkDeviceSize Size )
+  {
+    if (Size == 0)
+      return upload_ticket {};
+
+    // upload is larger than ring - stage it through dedicated buffer
+    if (Size > Capacity)
+    {
+      buffer StagingBuffer = Kernel->CreateBuffer(Size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+      std::memcpy(StagingBuffer.MapMemory(), SourceData, Size);
+      StagingBuffer.UnmapMemory();
+
+      VkCommandBuffer CommandBuffer = Kernel->BeginTransfer();
+      VkBufferCopy Copy { 0, DestinationOffset, Size };
+      vkCmdCopyBuffer(CommandBuffer, StagingBuffer.Buffer, Destination.Buffer, 1, &Copy);
+      Kernel->ReleaseToGraphics(CommandBuffer, Destination.Buffer, DestinationOffset, Size);
+      upload_ticket Ticket = Kernel->EndTransfer(CommandBuffer);
+
+      // staging buffer is destroyed after copy
+      Kernel->Retire(StagingBuffer);
+      return Ticket;
+    }
+
+    // staged data would be released with this upload ticket, before it is copied
+    utils::Assert(Committed == Head, "staging ring has not committed data");
+
+    VkDeviceSize Offset = Stage(SourceData, Size);
+
+    VkCommandBuffer CommandBuffer = Kernel->BeginTransfer();
+    VkBufferCopy Copy { Offset, DestinationOffset, Size };
+    vkCmdCopyBuffer(CommandBuffer, Buffer.Buffer, Destination.Buffer, 1, &Copy);
+    Kernel->ReleaseToGraphics(CommandBuffer, Destination.Buffer, DestinationOffset, Size);
+    upload_ticket Ticket = Kernel->EndTransfer(CommandBuffer);
+
+    Commit(Ticket);
+
+    return Ticket;
+  } /* Upload */
+
+  VkDeviceSize staging_ring::Stage( const VOID *SourceData, VkDeviceSize Size )
+  {
+    Retire();
+
+    VkDeviceSize Offset = Reserve(Size);
+    if (Offset != InvalidOffset)
+      std::memcpy(Data + Offset, SourceData, Size);
+
+    return Offset;
+  } /* Stage */
+
+  VOID staging_ring::Commit( upload_ticket Ticket )
+  {
+    Commit(Kernel->TransferTimeline, Ticket.Value);
+  } /* Commit */
+
+  VOID staging_ring::Commit( VkSemaphore Timeline, UINT64 Value )
+  {
+    if (Committed == Head)
+      return;
+
+    InFlight.push_back(submission { .Timeline = Timeline, .Value = Value, .End = Head });
+    Committed = Head;
+  } /* Commit */
+
+  VOID staging_ring::Close( VOID )
+  {
+    Flush();
+
+    Kernel->Destroy(Buffer);
+    Data = nullptr;
+  } /* Close */
+
+  VOID frame_ring::Initialize( kernel *NewKernel, VkDeviceSize NewSliceSize, UINT32 NewSliceCount, VkBufferUsageFlags Usage, VkDeviceSize NewAlignment )
+  {
+    Kernel = NewKernel;
+    Alignment = std::max<VkDeviceSize>(NewAlignment, 1);
+    SliceSize = utils::Align(NewSliceSize, Alignment);
+    SliceCount = NewSliceCount;
+    Slice = 0;
+    Cursor = 0;
+
+    // on resizable BAR uniforms are written straight to video memory
+    Buffer = Kernel->CreateBuffer(SliceSize * SliceCount, Usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    Data = reinterpret_cast<BYTE *>(Buffer.MapMemory());
+  } /* Initialize */
+
+  VOID frame_ring::BeginFrame( UINT32 NewSlice )
+  {
+    Slice = NewSlice % SliceCount;
+    Cursor = 0;
+  } /* BeginFrame */
+
+  VkDeviceSize frame_ring::Allocate( VkDeviceSize Size, VOID **Pointer )
+  {
+    VkDeviceSize Start = utils::Align(Cursor, Alignment);
+
+    utils::Assert(Start + Size <= SliceSize, "frame ring slice overflow");
+
+    Cursor = Start + Size;
+
+    VkDeviceSize Offset = Slice * SliceSize + Start;
+    *Pointer = Data + Offset;
+
+    return Offset;
+  } /* Allocate */
+
+  VOID frame_ring::Close( VOID )
+  {
+    Kernel->Destroy(Buffer);
+    Data = nullptr;
+  } /* Close */
+
+  VOID upload_batch::Initialize( kernel *NewKernel )
+  {
+    Kernel = NewKernel;
+    Depth = 0;
+  } /* Initialize */
+
+  VOID upload_batch::Begin( VOID )
+  {
+    Depth++;
+  } /* Begin */
+
+  upload_ticket upload_batch::End( VOID )
+  {
+    utils::Assert(Depth != 0, "upload batch end without begin");
+
+    if (--Depth != 0)
+      return Ticket;
+
+    return Submit();
+  } /* End */
+
+  VkCommandBuffer upload_batch::GetCommandBuffer( VOID )
+  {
+    if (CommandBuffer == VK_NULL_HANDLE)
+      CommandBuffer = Kernel->BeginTransfer();
+
+    return CommandBuffer;
+  } /* GetCommandBuffer */
+
+  VkDeviceSize upload_batch::Stage( const VOID *Data, VkDeviceSize Size )
+  {
+    VkDeviceSize Offset = Kernel->StagingRing.Stage(Data, Size);
+
+    // ring is full of batch data - submit it to release space
+    if (Offset == staging_ring::InvalidOffset)
+    {
+      Submit();
+      Offset = Kernel->StagingRing.Stage(Data, Size);
+    }
+
+    return Offset;
+  } /* Stage */
+
+  VOID upload_batch::WriteBuffer( buffer &Destination, VkDeviceSize DestinationOffset, const VOID *Data, VkDeviceSize Size )
+  {
+    if (Size == 0)
+      return;
+
+    // write doesn't fit in ring - submit collected writes to keep order and upload it separately
+    if (Size > Kernel->StagingRing.GetCapacity())
+    {
+      Submit();
+      Ticket = Kernel->StagingRing.Upload(Destination, DestinationOffset, Data, Size);
+      return;
+    }
+
+    VkDeviceSize Offset = Stage(Data, Size);
+
+    VkBufferCopy Copy { Offset, DestinationOffset, Size };
+    vkCmdCopyBuffer(GetCommandBuffer(), Kernel->StagingRing.GetBuffer(), Destination.Buffer, 1, &Copy);
+    Kernel->ReleaseToGraphics(GetCommandBuffer(), Destination.Buffer, DestinationOffset, Size);
+  } /* WriteBuffer */
+
+  VOID upload_batch::WriteImage( image &Destination, const VOID *Data, VkDeviceSize Size, VkImageLayout FinalLayout )
+  {
+    utils::Assert(Size <= Kernel->StagingRing.GetCapacity(), "image is too large for upload batch");
+
+    VkDeviceSize Offset = Stage(Data, Size);
+    VkCommandBuffer Commands = GetCommandBuffer();
+
+    VkImageMemoryBarrier ImageMemoryBarrier
+    {
+      /* VkStructureType         */ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+      /* const void*             */ .pNext = nullptr,
+      /* VkAccessFlags           */ .srcAccessMask = 0,
+      /* VkAccessFlags           */ .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      /* VkImageLayout           */ .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+      /* VkImageLayout           */ .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      /* uint32_t                */ .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      /* uint32_t                */ .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      /* VkImage                 */ .image = Destination.Image,
+      /* VkImageSubresourceRange */ .subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 },
+    };
+
+    vkCmdPipelineBarrier(Commands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &ImageMemoryBarrier);
+
+    VkBufferImageCopy Copy
+    {
+      /* VkDeviceSize             */ .bufferOffset = Offset,
+      /* uint32_t                 */ .bufferRowLength = 0,
+      /* uint32_t                 */ .bufferImageHeight = 0,
+      /* VkImageSubresourceLayers */ .imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
+      /* VkOffset3D               */ .imageOffset = { 0, 0, 0 },
+      /* VkExtent3D               */ .imageExtent = { Destination.Width, Destination.Height, 1 },
+    };
+
+    vkCmdCopyBufferToImage(Commands, Kernel->StagingRing.GetBuffer(), Destination.Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &Copy);
+
+    ImageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    ImageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    ImageMemoryBarrier.newLayout = FinalLayout;
+
+    // consumers wait for transfer timeline, so no destination stage is required on transfer queue
+    Kernel->ReleaseToGraphics(Commands, ImageMemoryBarrier, VK_PIPELINE_STAGE_TRANSFER_BIT);
+  } /* WriteImage */
+
+  upload_ticket upload_batch::Submit( VOID )
+  {
+    if (CommandBuffer == VK_NULL_HANDLE)
+      return Ticket;
+
+    Ticket = Kernel->EndTransfer(CommandBuffer);
+    Kernel->StagingRing.Commit(Ticket);
+    CommandBuffer = VK_NULL_HANDLE;
+
+    return Ticket;
+  } /* Submit */
+} /* namespace vrt::render::core */
@@ -13,12 +13,174 @@ namespace vrt
     {
       class kernel;
 
+      /* Range allocator. Keeps free ranges both in offset order (for coalescing) and in size order (for best-fit search). */
+      class range_allocator
+      {
+        std::map<VkDeviceSize, VkDeviceSize> FreeByOffset;    // free ranges by offset (offset -> size)
+        std::multimap<VkDeviceSize, VkDeviceSize> FreeBySize; // free ranges by size (size -> offset)
+        VkDeviceSize Capacity = 0;                            // total managed size
+        VkDeviceSize Used = 0;                                // allocated size
+
+        /* Free range inserting function */
+        VOID InsertFree( VkDeviceSize Offset, VkDeviceSize Size );
+
+        /* Free range removing function */
+        VOID EraseFree( std::map<VkDeviceSize, VkDeviceSize>::iterator Range );
+
+      public:
+        static constexpr VkDeviceSize InvalidOffset = UINT64_MAX;
+
+        /* Allocator (re)initialization function */
+        VOID Initialize( VkDeviceSize NewCapacity );
+
+        /* Range allocation function. Returns InvalidOffset if no range fits. */
+        VkDeviceSize Allocate( VkDeviceSize Size, VkDeviceSize Alignment );
+
+        /* Range freeing function */
+        VOID Free( VkDeviceSize Offset, VkDeviceSize Size );
+
+        VkDeviceSize GetCapacity( VOID ) const { return Capacity; } /* GetCapacity */
+        VkDeviceSize GetUsed( VOID ) const { return Used; } /* GetUsed */
+        SIZE_T GetFreeRangeCount( VOID ) const { return FreeByOffset.size(); } /* GetFreeRangeCount */
+        VkDeviceSize GetLargestFreeRange( VOID ) const { return FreeBySize.empty() ? 0 : FreeBySize.rbegin()->first; } /* GetLargestFreeRange */
+      }; /* range_allocator */
+
+      /* Device memory block (VkDeviceMemory object sub-allocated by memory_allocator) */
+      struct memory_block
+      {
+        VkDeviceMemory Memory = VK_NULL_HANDLE; // memory object
+        VkDeviceSize Size = 0;                  // memory object size
+        UINT32 MemoryTypeIndex = UINT32_MAX;    // memory type of block
+        BYTE *MappedData = nullptr;             // persistent mapping of block (host-visible types only)
+        BOOL IsDedicated = FALSE;               // block holds exactly one allocation
+        SIZE_T AllocationCount = 0;             // number of live allocations in block
+        range_allocator Ranges;                 // free ranges of block
+      }; /* memory_block */
+
+      /* Sub-allocated device memory range */
+      struct memory_allocation
+      {
+        VkDeviceMemory Memory = VK_NULL_HANDLE; // memory object
+        VkDeviceSize Offset = 0;                // offset of allocation in memory object
+        VkDeviceSize Size = 0;                  // size of allocation
+        BYTE *MappedData = nullptr;             // mapped allocation data (host-visible types only)
+        memory_block *Block = nullptr;          // block allocation lives in
+      }; /* memory_allocation */
+
+      /* Memory allocator statistics */
+      struct memory_stats
+      {
+        SIZE_T BlockCount = 0;             // number of VkDeviceMemory objects
+        SIZE_T DedicatedBlockCount = 0;    // number of dedicated blocks
+        SIZE_T AllocationCount = 0;        // number of live allocations
+        VkDeviceSize BytesReserved = 0;    // size of all blocks
+        VkDeviceSize BytesInUse = 0;       // size of all allocations (including alignment padding)
+        SIZE_T FreeRangeCount = 0;         // number of free ranges
+        VkDeviceSize LargestFreeRange = 0; // largest free range among all blocks
+        FLOAT Fragmentation = 0;           // 1 - LargestFreeRange / (free bytes), 0 if there is no free memory
+      }; /* memory_stats */
+
+      /* Memory heap budget */
+      struct memory_budget
+      {
+        VkDeviceSize Budget = 0;         // bytes process can allocate from heap without performance loss
+        VkDeviceSize Usage = 0;          // bytes allocated from heap (by whole process, if VK_EXT_memory_budget is supported)
+        VkDeviceSize AllocatorBytes = 0; // bytes allocated from heap by allocator
+      }; /* memory_budget */
+
+      /* Device memory allocator. Carves buffers and images out of large per memory type blocks. */
+      class memory_allocator
+      {
+        kernel *Kernel = nullptr;
+        VkPhysicalDeviceMemoryProperties MemoryProperties {};
+        VkDeviceSize BufferImageGranularity = 1;
+        std::vector<std::vector<memory_block *>> Blocks; // blocks by memory type index
+
+        BOOL IsBudgetSupported = FALSE;                             // is VK_EXT_memory_budget enabled
+        VkDeviceSize HeapBudget[VK_MAX_MEMORY_HEAPS] {};            // heap budgets at last update
+        VkDeviceSize HeapUsage[VK_MAX_MEMORY_HEAPS] {};             // heap usages at last update
+        VkDeviceSize HeapAllocated[VK_MAX_MEMORY_HEAPS] {};         // bytes of blocks allocated from heap
+        VkDeviceSize HeapAllocatedAtUpdate[VK_MAX_MEMORY_HEAPS] {}; // bytes of blocks allocated from heap at last update
+        BOOL IsOverBudgetReported[VK_MAX_MEMORY_HEAPS] {};          // is heap over budget reported to log
+
+        /* Block creating function. Returns nullptr if device memory can't be allocated. */
+        memory_block * CreateBlock( UINT32 MemoryTypeIndex, VkDeviceSize Size, BOOL IsDedicated );
+
+        /* Block destroying function */
+        VOID DestroyBlock( memory_block *Block );
+
+        /* Cached empty blocks of heap freeing function. Returns TRUE if any memory was freed. */
+        BOOL EvictEmptyBlocks( UINT32 HeapIndex );
+
+        /* Allocation from exact memory type function. Returns allocation without block on failure. */
+        memory_allocation AllocateFromType( VkDeviceSize Size, VkDeviceSize Alignment, UINT32 MemoryTypeIndex );
+
+        /* Allocation from best of fitting memory types function. Types, which failed to allocate, are removed from TypeFilter. */
+        memory_allocation AllocateFromTypes( VkDeviceSize Size, VkDeviceSize Alignment, UINT32 &TypeFilter, VkMemoryPropertyFlags RequiredFlags, VkMemoryPropertyFlags PreferredFlags );
+
+        /* Statistics accumulation function */
+        VOID CollectStats( UINT32 MemoryTypeIndex, memory_stats &Stats ) const;
+
+      public:
+        static constexpr VkDeviceSize DefaultBlockSize = 64 * 1024 * 1024;
+
+        /* Allocator initialization function */
+        VOID Initialize( kernel *NewKernel, BOOL NewIsBudgetSupported );
+
+        /* Heap budgets updating function (called once per frame) */
+        VOID UpdateBudget( VOID );
+
+        /* Heap budget getting function */
+        memory_budget GetBudget( UINT32 HeapIndex ) const;
+
+        /* Cached memory properties getting function */
+        const VkPhysicalDeviceMemoryProperties & GetProperties( VOID ) const
+        {
+          return MemoryProperties;
+        } /* GetProperties */
+
+        /* Memory type choosing function. Types within heap budget are preferred, then types with more of PreferredFlags.
+         * Returns UINT32_MAX if there is no type with RequiredFlags.
+         */
+        UINT32 FindMemoryType( UINT32 TypeFilter, VkMemoryPropertyFlags RequiredFlags, VkMemoryPropertyFlags PreferredFlags = 0, VkDeviceSize Size = 0 ) const;
+
+        /* Preferred block size for memory type getting function */
+        VkDeviceSize GetBlockSize( UINT32 MemoryTypeIndex ) const;
+
+        /* Memory allocation function.
+         * @param[in] Requirements     - resource memory requirements
+         * @param[in] RequiredFlags    - memory properties, which memory type must have
+         * @param[in] PreferredFlags   - memory properties, which are desirable (e.g. DEVICE_LOCAL for host-visible data on ReBAR)
+         * @param[in] IsOptimalImage   - is resource an optimal tiling image (bufferImageGranularity matters)
+         * If device local memory is exhausted, resource is placed into host memory.
+         */
+        memory_allocation Allocate( const VkMemoryRequirements &Requirements, VkMemoryPropertyFlags RequiredFlags, VkMemoryPropertyFlags PreferredFlags, BOOL IsOptimalImage );
+
+        /* Memory freeing function */
+        VOID Free( memory_allocation &Allocation );
+
+        /* Statistics of one memory type getting function */
+        memory_stats GetStats( UINT32 MemoryTypeIndex ) const;
+
+        /* Statistics of all memory types getting function */
+        memory_stats GetStats( VOID ) const;
+
+        /* Allocator deinitialization function */
+        VOID Close( VOID );
+      }; /* memory_allocator */
+
+      /* Asynchronous upload ticket. Upload is complete when transfer timeline semaphore reaches ticket value. */
+      struct upload_ticket
+      {
+        UINT64 Value = 0; // transfer timeline value (0 - nothing to wait for)
+      }; /* upload_ticket */
+
       struct buffer
       {
         kernel *Kernel = nullptr;
 
         VkBuffer Buffer = VK_NULL_HANDLE;
-        VkDeviceMemory Memory = VK_NULL_HANDLE;
+        memory_allocation Allocation {};
         SIZE_T Size = 0;
         UINT32 MemoryTypeIndex = 0;
 
@@ -34,13 +196,13 @@ namespace vrt
         /* Get device address of this buffer. */
         VkDeviceAddress GetDeviceAddress( VOID ) const;
 
-        /* copy buffer to destination */
-        VOID CopyTo( buffer &DestinationBuffer );
+        /* copy buffer to destination (asynchronous, on transfer queue) */
+        upload_ticket CopyTo( buffer &DestinationBuffer );
 
-        /* Write data to buffer using transfer buffer */
-        VOID WriteData( const VOID *Data, SIZE_T DataSize );
+        /* Write data to buffer using transfer buffer (asynchronous, on transfer queue). Inside upload batch empty ticket is returned, batch ticket covers write. */
+        upload_ticket WriteData( const VOID *Data, SIZE_T DataSize, VkDeviceSize Offset = 0 );
 
-        /* Map buffer memory to RAM address */
+        /* Map buffer memory to RAM address (host-visible memory is persistently mapped by allocator) */
         VOID * MapMemory( VOID );
 
         /* Unmap buffer memory */
@@ -51,12 +213,12 @@ namespace vrt
       {
         kernel *Kernel = nullptr;
 
-        VkImage Image;
-        VkDeviceMemory Memory;
-        VkFormat Format;
-        VkImageView ImageView;
-        UINT32 MemoryTypeIndex;
-        UINT32 Width, Height;
+        VkImage Image = VK_NULL_HANDLE;
+        memory_allocation Allocation {};
+        VkFormat Format = VK_FORMAT_UNDEFINED;
+        VkImageView ImageView = VK_NULL_HANDLE;
+        UINT32 MemoryTypeIndex = 0;
+        UINT32 Width = 0, Height = 0;
 
         image( kernel *Kernel = nullptr );
 
@@ -65,6 +227,450 @@ namespace vrt
         inline image & operator=( image &&Other ) noexcept;
       }; /* image */
 
+      /* Persistently mapped staging ring. Uploads are copied into ring and streamed to device on transfer queue. */
+      class staging_ring
+      {
+        /* Submitted copies description */
+        struct submission
+        {
+          VkSemaphore Timeline = VK_NULL_HANDLE; // timeline, signaled by copies submission (transfer or graphics)
+          UINT64 Value = 0;                      // timeline value of copies completion
+          VkDeviceSize End = 0;                  // ring position after copied data
+        }; /* submission */
+
+        kernel *Kernel = nullptr;
+        buffer Buffer {};                  // ring storage
+        BYTE *Data = nullptr;              // ring storage mapping
+        VkDeviceSize Capacity = 0;         // ring size
+        VkDeviceSize Head = 0;             // total number of bytes written to ring
+        VkDeviceSize Tail = 0;             // total number of bytes released by device
+        VkDeviceSize Committed = 0;        // total number of bytes, which copies are submitted
+        std::deque<submission> InFlight;   // not yet retired uploads (in submission order)
+
+        /* Oldest submission retiring function */
+        VOID RetireOldest( VOID );
+
+        /* Ring space reserving function. Returns position of reserved space or InvalidOffset if ring is full of not committed data. */
+        VkDeviceSize Reserve( VkDeviceSize Size );
+
+      public:
+        static constexpr VkDeviceSize DefaultCapacity = 16 * 1024 * 1024;
+        static constexpr VkDeviceSize InvalidOffset = UINT64_MAX;
+
+        /* Ring initialization function */
+        VOID Initialize( kernel *NewKernel, VkDeviceSize NewCapacity = DefaultCapacity );
+
+        /* Data uploading function. Copy is submitted to transfer queue, function doesn't wait for it. */
+        upload_ticket Upload( buffer &Destination, VkDeviceSize DestinationOffset, const VOID *SourceData, VkDeviceSize Size );
+
+        /* Data staging function. Data is copied to ring, caller records copy from returned offset and commits it. */
+        VkDeviceSize Stage( const VOID *SourceData, VkDeviceSize Size );
+
+        /* Staged data committing function. Staged ring space is released after ticket is complete. */
+        VOID Commit( upload_ticket Ticket );
+
+        /* Staged data committing function. Staged ring space is released after timeline reaches value (e.g. frame copies on graphics queue). */
+        VOID Commit( VkSemaphore Timeline, UINT64 Value );
+
+        /* Ring buffer getting function */
+        VkBuffer GetBuffer( VOID ) const
+        {
+          return Buffer.Buffer;
+        } /* GetBuffer */
+
+        /* Ring size getting function */
+        VkDeviceSize GetCapacity( VOID ) const
+        {
+          return Capacity;
+        } /* GetCapacity */
+
+        /* Finished uploads retiring function (doesn't block) */
+        VOID Retire( VOID );
+
+        /* All uploads waiting function */
+        VOID Flush( VOID );
+
+        /* Ring deinitialization function */
+        VOID Close( VOID );
+      }; /* staging_ring */
+
+      /* Persistently mapped ring with one slice per frame in flight. Allocations are linear inside current frame slice. */
+      class frame_ring
+      {
+        kernel *Kernel = nullptr;
+        buffer Buffer {};            // ring storage
+        BYTE *Data = nullptr;        // ring storage mapping
+        VkDeviceSize SliceSize = 0;  // size of one frame slice
+        VkDeviceSize Alignment = 1;  // allocation offset alignment
+        UINT32 SliceCount = 0;       // number of slices
+        UINT32 Slice = 0;            // current frame slice
+        VkDeviceSize Cursor = 0;     // allocation position in current slice
+
+      public:
+        /* Ring initialization function */
+        VOID Initialize( kernel *NewKernel, VkDeviceSize NewSliceSize, UINT32 NewSliceCount, VkBufferUsageFlags Usage, VkDeviceSize NewAlignment );
+
+        /* Frame starting function. Slice must not be used by device anymore. */
+        VOID BeginFrame( UINT32 NewSlice );
+
+        /* Allocation function. Returns offset from ring buffer start. */
+        VkDeviceSize Allocate( VkDeviceSize Size, VOID **Pointer );
+
+        /* Value writing function. Returns offset from ring buffer start (suitable as dynamic offset). */
+        template <typename type>
+          UINT32 Push( const type &Value )
+          {
+            VOID *Pointer = nullptr;
+            VkDeviceSize Offset = Allocate(sizeof(type), &Pointer);
+
+            std::memcpy(Pointer, &Value, sizeof(type));
+
+            return static_cast<UINT32>(Offset);
+          } /* Push */
+
+        /* Ring buffer getting function */
+        VkBuffer GetBuffer( VOID ) const
+        {
+          return Buffer.Buffer;
+        } /* GetBuffer */
+
+        /* Ring deinitialization function */
+        VOID Close( VOID );
+      }; /* frame_ring */
+
+      /* Upload batch. Collects many writes into one transfer command buffer, which is submitted once. */
+      class upload_batch
+      {
+        kernel *Kernel = nullptr;
+        VkCommandBuffer CommandBuffer = VK_NULL_HANDLE; // command buffer with recorded writes
+        UINT32 Depth = 0;                               // number of not ended batch beginnings
+        upload_ticket Ticket;                           // ticket of last batch submission
+
+        /* Recording command buffer getting function */
+        VkCommandBuffer GetCommandBuffer( VOID );
+
+        /* Data staging function. Submits batch if staging ring is full. */
+        VkDeviceSize Stage( const VOID *Data, VkDeviceSize Size );
+
+      public:
+        /* Batch initialization function */
+        VOID Initialize( kernel *NewKernel );
+
+        /* Batch beginning function. Buffer::WriteData calls are collected to batch until matching End call. */
+        VOID Begin( VOID );
+
+        /* Batch ending function. Submits collected writes, returns ticket of their completion. */
+        upload_ticket End( VOID );
+
+        /* Batch activity checking function */
+        BOOL IsActive( VOID ) const
+        {
+          return Depth != 0;
+        } /* IsActive */
+
+        /* Buffer writing function */
+        VOID WriteBuffer( buffer &Destination, VkDeviceSize DestinationOffset, const VOID *Data, VkDeviceSize Size );
+
+        /* Whole image writing function. Image is transfered from undefined to FinalLayout. */
+        VOID WriteImage( image &Destination, const VOID *Data, VkDeviceSize Size, VkImageLayout FinalLayout );
+
+        /* Collected writes submitting function. Batch stays active. */
+        upload_ticket Submit( VOID );
+      }; /* upload_batch */
+
+      /* One-shot command buffers allocator of one queue family, used by one thread.
+       * Command buffers are taken from transient pools, which are reset as whole after device finishes all their submissions.
+       */
+      class transient_command_allocator
+      {
+        /* Transient command pool */
+        struct pool
+        {
+          VkCommandPool CommandPool = VK_NULL_HANDLE;  // pool
+          std::vector<VkCommandBuffer> CommandBuffers; // command buffers allocated from pool (reused after reset)
+          UINT32 UsedCount = 0;                        // number of command buffers given out since last reset
+          UINT32 PendingCount = 0;                     // number of given out command buffers, which aren't submitted yet
+          UINT64 RetireValue = 0;                      // timeline value, after which all pool submissions are finished
+        }; /* pool */
+
+        kernel *Kernel = nullptr;
+        UINT32 QueueFamilyIndex = 0;
+        VkSemaphore Timeline = VK_NULL_HANDLE; // timeline semaphore, which is signaled by submissions of command buffers
+        std::vector<pool *> Pools;             // all pools
+        pool *Current = nullptr;               // pool command buffers are allocated from
+        std::deque<pool *> Retiring;           // filled pools, which can be used by device
+        std::vector<pool *> Free;              // reset pools
+
+        /* Pool of command buffer finding function */
+        pool * FindPool( VkCommandBuffer CommandBuffer );
+
+      public:
+        static constexpr UINT32 PoolCapacity = 32; // number of command buffers given out from pool between resets
+
+        /* Allocator initialization function */
+        VOID Initialize( kernel *NewKernel, UINT32 NewQueueFamilyIndex, VkSemaphore NewTimeline );
+
+        /* Command buffer allocation function. Command buffer must be submitted by this thread. */
+        VkCommandBuffer Allocate( VOID );
+
+        /* Command buffer submission registering function */
+        VOID Submitted( VkCommandBuffer CommandBuffer, UINT64 TimelineValue );
+
+        /* Finished pools resetting function (doesn't block) */
+        VOID Recycle( VOID );
+
+        /* Allocator deinitialization function. Device must be idle. */
+        VOID Close( VOID );
+      }; /* transient_command_allocator */
+
+      /* Command recording scheduler. Passes are recorded to secondary command buffers by worker threads in parallel
+       * and executed by primary command buffer in pass order.
+       */
+      class recording_scheduler
+      {
+      public:
+        /* Pass commands recording function */
+        using record_function = std::function<VOID( VkCommandBuffer CommandBuffer )>;
+
+        /* Recording pass */
+        struct pass
+        {
+          record_function Record;                                     // pass commands recording function (called by worker thread)
+          const VkRenderPassBeginInfo *RenderPassBeginInfo = nullptr; // render pass instance pass is executed in (nullptr - outside of render pass)
+        }; /* pass */
+
+      private:
+        /* Recording worker thread */
+        struct worker
+        {
+          std::thread Thread;                       // thread
+          std::vector<VkCommandPool> CommandPools;  // secondary command buffer pools, one per frame data
+        }; /* worker */
+
+        kernel *Kernel = nullptr;
+        std::vector<worker> Workers;
+
+        std::mutex Mutex;
+        std::condition_variable WorkCondition;    // notified when job is issued or scheduler is closed
+        std::condition_variable DoneCondition;    // notified when all workers finished job
+        UINT64 JobGeneration = 0;                 // number of issued jobs
+        UINT32 ActiveWorkerCount = 0;             // number of workers, which didn't finish current job
+        BOOL IsClosing = FALSE;
+
+        /* Current job */
+        std::span<const pass> JobPasses;
+        UINT32 JobFrameSlot = 0;
+        VkCommandBuffer *JobCommandBuffers = nullptr;
+
+        /* Worker thread function */
+        VOID WorkerMain( UINT32 WorkerIndex );
+
+        /* Pass recording function */
+        VOID RecordPass( UINT32 WorkerIndex, SIZE_T PassIndex );
+
+      public:
+        /* Scheduler initialization function.
+         * @param[in] WorkerCount - number of recording threads
+         * @param[in] FrameCount  - number of frame data sets, each worker gets command pool per set
+         */
+        VOID Initialize( kernel *NewKernel, UINT32 WorkerCount, UINT32 FrameCount );
+
+        /* Passes recording function. Blocks until all passes are recorded.
+         * Command buffers of previous recording for same frame data are re-recorded, so they must not be used by device.
+         * Pass is always recorded by the same worker, so command buffers are bound to frame data and pass index.
+         */
+        VOID Record( std::span<const pass> Passes, UINT32 FrameSlot, std::vector<VkCommandBuffer> &CommandBuffers );
+
+        /* Recorded passes executing function. Passes with same render pass instance are executed in one render pass. */
+        VOID Execute( VkCommandBuffer PrimaryCommandBuffer, std::span<const pass> Passes, std::span<const VkCommandBuffer> CommandBuffers );
+
+        /* Command buffers of passes freeing function. Device must not use them. */
+        VOID Free( UINT32 FrameSlot, std::vector<VkCommandBuffer> &CommandBuffers );
+
+        /* Scheduler deinitialization function */
+        VOID Close( VOID );
+      }; /* recording_scheduler */
+
+      /* Read back frames encoder. Frames are passed through bounded queue and saved by several encoder threads.
+       * Frame format is chosen by file extension: '.pfm' - averaged linear colors as floats, other - tone mapped PNG.
+       */
+      class frame_encoder
+      {
+      public:
+        /* Read back frame */
+        struct frame
+        {
+          std::vector<vec4> Data;          // accumulated target image pixels
+          UINT32 Width = 0, Height = 0;    // image extent
+          UINT32 CollectionFrameCount = 1; // number of frames accumulated in image
+          std::string FileName;            // file frame is saved to
+        }; /* frame */
+
+      private:
+        std::vector<std::thread> Threads;
+        std::mutex Mutex;
+        std::condition_variable WorkCondition;  // notified when frame is pushed or encoder is closed
+        std::condition_variable SpaceCondition; // notified when frame is taken from queue
+        std::deque<frame> Queue;                // frames waiting for encoding
+        SIZE_T Capacity = 1;                    // maximal number of queued frames
+        BOOL IsClosing = FALSE;
+
+        /* Encoder thread function */
+        VOID WorkerMain( VOID );
+
+      public:
+        /* Encoder initialization function */
+        VOID Initialize( UINT32 ThreadCount, SIZE_T QueueCapacity );
+
+        /* Frame pushing function. Blocks while queue is full, so it must not be called by render thread. */
+        VOID Push( frame &&Frame );
+
+        /* Encoder deinitialization function. Waits for all pushed frames to be saved. */
+        VOID Close( VOID );
+      }; /* frame_encoder */
+
+      /* Asynchronous target image readback ring. Target image is copied to ring of host-visible buffers after frame raytracing,
+       * copies are waited by worker thread and passed to frame encoder, so render loop never waits for them.
+       */
+      class readback_ring
+      {
+        /* Readback slot */
+        struct slot
+        {
+          buffer Buffer;                                  // host-visible copy of target image
+          VkCommandBuffer CommandBuffer = VK_NULL_HANDLE; // copy commands
+          VkFence Fence = VK_NULL_HANDLE;                 // signaled when copy is finished, waited and reset by worker
+          UINT32 Width = 0, Height = 0;                   // extent of copied image
+          UINT32 CollectionFrameCount = 1;                // number of frames accumulated in copied image
+          std::string FileName;                           // file copy is saved to
+          BOOL IsBusy = FALSE;                            // is slot used by device or worker (guarded by mutex)
+        }; /* slot */
+
+        kernel *Kernel = nullptr;
+        frame_encoder *Encoder = nullptr;
+        std::vector<slot> Slots;
+        std::deque<std::string> Requests; // file names of requested readbacks, which aren't submitted yet (render thread only)
+
+        std::thread Worker;
+        std::mutex Mutex;
+        std::condition_variable WorkCondition; // notified when copy is submitted or ring is closed
+        std::deque<UINT32> Pending;            // indices of submitted slots in submission order
+        BOOL IsClosing = FALSE;
+
+        /* Worker thread function */
+        VOID WorkerMain( VOID );
+
+      public:
+        /* Ring initialization function. Copies are passed to NewEncoder. */
+        VOID Initialize( kernel *NewKernel, frame_encoder *NewEncoder, UINT32 SlotCount );
+
+        /* Readback requesting function. Image is copied by one of next frames, as soon as there is free slot. */
+        VOID Request( std::string_view FileName );
+
+        /* Immediate readback availability checking function. Returns TRUE if request would be submitted by next frame. */
+        BOOL IsAvailable( VOID );
+
+        /* Requested readback submitting function. Must be called after raytracing submission to graphics queue (doesn't block). */
+        VOID Submit( const image &Image, VkExtent2D Extent, UINT32 CollectionFrameCount );
+
+        /* Ring deinitialization function. Waits for worker to pass all submitted copies to encoder. Device must be idle. */
+        VOID Close( VOID );
+      }; /* readback_ring */
+
+      /* Range of geometry pool */
+      struct geometry_range
+      {
+        UINT32 Page = UINT32_MAX; // pool page index (UINT32_MAX - range is not allocated)
+        VkDeviceSize Offset = 0;  // offset in page buffer
+        VkDeviceSize Size = 0;    // range size
+      }; /* geometry_range */
+
+      /* Shared geometry pool. Vertex and index data of primitives are sub-allocated from few large device-local buffers. */
+      class geometry_pool
+      {
+        /* Pool page */
+        struct page
+        {
+          buffer Buffer {};                  // page buffer
+          VkDeviceAddress Address = 0;       // page buffer device address
+          range_allocator Ranges;            // page space
+          SIZE_T RangeCount = 0;             // number of allocated ranges
+        }; /* page */
+
+        kernel *Kernel = nullptr;
+        std::vector<page *> Pages;           // pool pages (nullptr - destroyed page, index can be reused)
+        VkDeviceSize PageSize = 0;           // default page size
+
+        /* Page creating function */
+        UINT32 CreatePage( VkDeviceSize Size );
+
+        /* Page destroying function */
+        VOID DestroyPage( UINT32 Index );
+
+      public:
+        static constexpr VkDeviceSize DefaultPageSize = 64 * 1024 * 1024;
+        static constexpr VkDeviceSize RangeAlignment = 16;
+
+        /* Pool initialization function */
+        VOID Initialize( kernel *NewKernel, VkDeviceSize NewPageSize = DefaultPageSize );
+
+        /* Range allocation function */
+        geometry_range Allocate( VkDeviceSize Size );
+
+        /* Range freeing function. Freed space is reused by next allocations. */
+        VOID Free( geometry_range &Range );
+
+        /* Range buffer getting function */
+        buffer & GetBuffer( const geometry_range &Range );
+
+        /* Range device address getting function */
+        VkDeviceAddress GetAddress( const geometry_range &Range ) const;
+
+        /* Pool deinitialization function */
+        VOID Close( VOID );
+      }; /* geometry_pool */
+
+      /* Scratch memory arena of frame acceleration structure builds. Storage grows to high-water mark of build batches and is reused by all of them.
+       * Arena isn't synchronized - it is used only by frame command buffers, which are recorded under kernel submit mutex.
+       * Builds of single time command buffers (model and scene creation of loader threads) use standalone scratch instead.
+       * Several batches may be recorded into one unsubmitted frame, so replaced storage may be used by it and is retired only after frame is submitted.
+       */
+      class scratch_arena
+      {
+        kernel *Kernel = nullptr;
+        buffer Buffer {};              // arena storage
+        std::vector<buffer> ReplacedBuffers; // storages replaced since last frame submission
+        VkDeviceAddress Address = 0;   // storage address, aligned for scratch
+        VkDeviceSize Capacity = 0;     // usable storage size
+        VkDeviceSize Alignment = 1;    // scratch range alignment
+
+        /* Batch ranges packing function. Returns ranges offsets in addresses and total size. */
+        VkDeviceSize Pack( std::span<const VkDeviceSize> Sizes, std::span<VkDeviceAddress> Addresses ) const;
+
+      public:
+        static constexpr VkDeviceSize GrowthGranularity = 1024 * 1024;
+
+        /* Arena initialization function */
+        VOID Initialize( kernel *NewKernel );
+
+        /* Build batch scratch ranges allocating function. Ranges of batch don't overlap, so builds of batch may run concurrently.
+         * Previous batches ranges are reused - barrier, which orders batch builds after previous ones, is recorded.
+         * If storage is too small, it is replaced by larger one and old storage is kept until RetireReplaced call.
+         */
+        VOID Allocate( VkCommandBuffer CommandBuffer, std::span<const VkDeviceSize> Sizes, std::span<VkDeviceAddress> Addresses );
+
+        /* Standalone scratch creating function. Ranges are packed as arena ones into own buffer, which caller destroys after builds are finished.
+         * Doesn't touch arena storage, so may be called from any thread.
+         */
+        buffer CreateStandalone( std::span<const VkDeviceSize> Sizes, std::span<VkDeviceAddress> Addresses ) const;
+
+        /* Replaced storages retiring function. Must be called after frame, which batches are recorded to, is submitted. */
+        VOID RetireReplaced( VOID );
+
+        /* Arena deinitialization function. Device must be idle. */
+        VOID Close( VOID );
+      }; /* scratch_arena */
+
       struct rt_shader
       {
         enum struct module_type
@@ -165,10 +771,32 @@ namespace vrt
         SIZE_T VertexPositionComponentOffset = 0;
         SIZE_T VertexSize = 0;
         buffer VertexBuffer {};
+        geometry_range VertexRange {}; // vertex data range in geometry pool (if pool is used)
         SIZE_T VertexCount = 0;
         buffer IndexBuffer {};
+        geometry_range IndexRange {};  // index data range in geometry pool (if pool is used)
         SIZE_T IndexCount = 0;
         mat4 TrasnformMatrix = mat4::Identity();
+        vec3 BoundsMin = vec3(0), BoundsMax = vec3(0); // vertex positions bounding box
+        UINT64 GeometryGeneration = 0;                 // number of vertex rewrites, models refit BLASes built with other generation (primitive may be shared)
+        BOOL IsStatic = FALSE;                         // is primitive included in static model (its vertices can't be rewritten)
+
+        /* Bounding box evaluating function. Positions are read from vertices of primitive layout. */
+        VOID EvaluateBounds( const VOID *Vertices );
+
+        /* Geometry invalidation function. Must be called after vertices are rewritten on device (e.g. by compute shader).
+         * Bounds of new vertices decide between BLAS refit and rebuild, so they are passed by caller.
+         * Writes submitted to graphics queue before next frame are ordered by its scene update barrier. Writes of other queues
+         * pass timeline value signaled after them, next frame waits for it (vertex buffer ownership is kept by graphics queue family).
+         * Frames in flight may still trace old vertices, so writer must not overwrite them before those frames are finished.
+         */
+        VOID InvalidateGeometry( const vec3 &NewBoundsMin, const vec3 &NewBoundsMax, VkSemaphore WriteTimeline = VK_NULL_HANDLE, UINT64 WriteValue = 0 );
+
+        /* Vertex data device address getting function */
+        VkDeviceAddress GetVertexAddress( VOID ) const;
+
+        /* Index data device address getting function (0 if primitive has no indices) */
+        VkDeviceAddress GetIndexAddress( VOID ) const;
 
         ~primitive( VOID ) override;
       }; /* primitive */
@@ -185,15 +813,55 @@ namespace vrt
         buffer BLASStorageBuffer {};
         VkAccelerationStructureKHR BLAS = VK_NULL_HANDLE;
 
+        UINT64 TransformGeneration = 0;  // number of transformation changes, scenes rewrite instances of model if it differs from written one
+
+        BOOL IsDynamic = FALSE;          // is geometry of model deformed (BLAS is refitted and isn't compacted)
+        VkDeviceSize BuildScratchSize = 0;  // scratch size of BLAS build
+        VkDeviceSize UpdateScratchSize = 0; // scratch size of BLAS refit
+        UINT32 RefitCount = 0;           // number of BLAS refits since last full build
+        FLOAT BuildBoundsArea = 0;       // bounding box surface area at last full build
+        std::vector<UINT64> BuiltGeometryGenerations; // geometry generations of primitives, BLAS is built with
+        UINT64 BLASGeneration = 0;       // number of BLAS refits and rebuilds, scenes update TLAS if it differs from one instances are written with
+
+        /* Bounding box of all primitives surface area getting function */
+        FLOAT GetBoundsArea( VOID ) const;
+
+        /* Geometry change checking function. Returns TRUE if some primitive is rewritten after BLAS build. */
+        BOOL IsGeometryChanged( VOID ) const;
+
+        /* Transformation setting function. Transformation applies to every instance of model, scene TLAS is updated by next frame. */
+        VOID SetTransform( const mat4 &NewTransformMatrix )
+        {
+          TransformMatrix = NewTransformMatrix;
+          TransformGeneration++;
+        } /* SetTransform */
+
         ~model( VOID );
       }; /* model */
 
+      /* Model description for batched creation */
+      struct model_description
+      {
+        std::span<primitive *> Primitives;       // primitives model includes
+        mat4 TransformMatrix = mat4::Identity(); // model transformation matrix
+        BOOL IsDynamic = FALSE;                  // is model geometry deformed after creation
+      }; /* model_description */
+
+      /* Scene instance of model. Instances of one model share its BLAS and hit groups. */
+      struct instance
+      {
+        model *Model = nullptr;                  // instanced model (must be one of scene models)
+        mat4 TransformMatrix = mat4::Identity(); // instance transformation, applied after model transformation
+        UINT32 Mask = 0xFF;                      // ray visibility mask (8 bits)
+        UINT32 CustomIndex = 0;                  // instance index available to shaders (24 bits)
+        UINT32 ModelIndex = 0;                   // index of instanced model in scene models, filled by scene creation
+      }; /* instance */
+
       struct scene : resource<std::string>
       {
         kernel *Kernel = nullptr;
 
         camera Camera;
-        buffer GlobalBuffer;
 
         VkPipeline Pipeline = VK_NULL_HANDLE;
         VkPipelineLayout PipelineLayout = VK_NULL_HANDLE;
@@ -205,12 +873,28 @@ namespace vrt
         buffer LightStorageBuffer;
 
 
-        std::vector<model *> Models;
+        std::vector<model *> Models;  // models, every primitive of which has its own hit group
+        std::vector<UINT64> ModelTransformGenerations; // transformation generations of models, instances are written with (model may be shared with other scenes)
+        std::vector<UINT64> ModelBLASGenerations;      // BLAS generations of models, TLAS is built with
+        std::vector<instance> Instances;
+        BOOL IsInstancesChanged = FALSE; // must instances be rewritten by next frame
+        std::vector<VkAccelerationStructureInstanceKHR> ModelInstances; // TLAS instances of models by model index, instances are written from
+        std::vector<VkAccelerationStructureInstanceKHR> InstanceData; // instances in TLAS layout, written to instance buffer as whole
         buffer TLASStorageBuffer {};
         VkAccelerationStructureKHR TLAS = VK_NULL_HANDLE;
-        buffer InstanceBuffer {};
+        VkDeviceSize TLASBuildScratchSize = 0;  // scratch size of TLAS build
+        VkDeviceSize TLASUpdateScratchSize = 0; // scratch size of in-place TLAS update
+        UINT32 TLASUpdateCount = 0;   // number of in-place TLAS updates since last full build
+        buffer InstanceBuffer {};     // instances of every frame in flight, indexed by frame data index
         SIZE_T InstanceCount = 0;
 
+        /* Instance transformation setting function. TLAS is updated by next frame. */
+        VOID SetInstanceTransform( SIZE_T Index, const mat4 &NewTransformMatrix )
+        {
+          Instances[Index].TransformMatrix = NewTransformMatrix;
+          IsInstancesChanged = TRUE;
+        } /* SetInstanceTransform */
+
         SIZE_T SBTAlignedGroupSize = 0;
         buffer SBTStorageBuffer; // Shader binding table storage buffer
         SIZE_T HitShaderGroupCount = 0;
@@ -229,7 +913,9 @@ namespace vrt
 
       struct present_buffer_data
       {
-        UINT32 CollectionFrameCount;
+        UINT32 CollectionFrameCount; // number of frames accumulated in target image
+        UINT32 PostImageIndex;       // index of post image, processed by this frame
+        UINT32 PresentImageIndex;    // index of post image, presented by this frame
       }; /* present_buffer_data */
 
       struct topology
@@ -383,9 +1069,22 @@ namespace vrt
       class kernel : manager<scene, std::string>, manager<material, std::string>, manager<model>, manager<primitive>
       {
       public:
+        static constexpr UINT32 MaxFramesInFlight = 3; // Maximal number of frames, which resources can be used by device simultaneously
+
+        UINT32 FramesInFlight = 2;         // Number of frames, which are recorded by host while device renders previous ones (1..MaxFramesInFlight)
         SIZE_T CurrentFrame = 0;           // Current frame index
+        SIZE_T CompletedFrameCount = 0;    // Number of frames, which are known to be finished by device
+
+        SDL_Window *Window = nullptr;      // Window pointer (nullptr - headless rendering)
+        utils::timer *LatencyTimer = nullptr; // timer input to present latency is reported to (nullptr - latency isn't measured)
 
-        SDL_Window *Window = nullptr;      // Window pointer
+        /* Presentation policy */
+        struct present_policy
+        {
+          VkPresentModeKHR PresentMode = VK_PRESENT_MODE_MAILBOX_KHR; // preferred present mode (FIFO is used if it isn't supported)
+          UINT32 ImageCount = 3;                                      // preferred swapchain image count (clamped by surface capabilities)
+          UINT32 MaxQueuedFrames = 2;                                 // maximal number of frames queued to device (frames in flight)
+        }; /* present_policy */
         BOOL InstanceSetupProcess = FALSE; // flag for validation layers not sh*tting in log by infinite DLL's loading und other 'useful log info'
 
         VkInstance Instance = VK_NULL_HANDLE;
@@ -405,18 +1104,115 @@ namespace vrt
         } QueueFamilies;
 
         VkDevice Device = VK_NULL_HANDLE;
+        BOOL IsMemoryBudgetSupported = FALSE; // is VK_EXT_memory_budget enabled
         VkSurfaceKHR Surface = VK_NULL_HANDLE;
 
+        memory_allocator MemoryAllocator; // device memory sub-allocator
+        staging_ring StagingRing;         // upload staging ring
+        frame_ring UniformRing;           // per-frame uniform data
+        upload_batch UploadBatch;         // current upload batch
+        geometry_pool GeometryPool;       // shared primitive geometry storage
+        scratch_arena ScratchArena;       // acceleration structure builds scratch
+        BOOL DoUseGeometryPool = TRUE;    // are new primitives placed in geometry pool
+        BOOL DoCompactBLAS = TRUE;        // are bottom level acceleration structures of new models compacted
+        UINT32 TLASRebuildPeriod = 64;    // number of in-place TLAS updates, after which TLAS is fully rebuilt
+        UINT32 BLASRefitLimit = 16;       // number of dynamic model BLAS refits, after which BLAS is fully rebuilt
+        FLOAT BLASBoundsGrowthLimit = 2;  // dynamic model bounding box area growth since last build, after which BLAS is rebuilt instead of refit
+
+        /* Primitive vertices write, which is recorded by next frame */
+        struct vertex_write
+        {
+          primitive *Primitive = nullptr; // written primitive (grabbed until write is recorded)
+          std::vector<BYTE> Data;         // written data, staged to staging ring by frame, which copies it
+        }; /* vertex_write */
+
+        std::vector<vertex_write> PendingVertexWrites; // vertex writes, which are copied on graphics queue before next frame raytracing
+
+        /* Timeline waits of next frame raytracing submission. Storage is reused by every frame. */
+        struct frame_waits
+        {
+          std::vector<VkSemaphore> Semaphores;
+          std::vector<UINT64> Values;
+          std::vector<VkPipelineStageFlags> Stages;
+
+          /* Wait adding function. Waits for one timeline are merged into wait for larger value. */
+          VOID Add( VkSemaphore Semaphore, UINT64 Value, VkPipelineStageFlags Stage )
+          {
+            for (SIZE_T i = 0; i < Semaphores.size(); i++)
+              if (Semaphores[i] == Semaphore)
+              {
+                Values[i] = std::max(Values[i], Value);
+                Stages[i] |= Stage;
+                return;
+              }
+
+            Semaphores.push_back(Semaphore);
+            Values.push_back(Value);
+            Stages.push_back(Stage);
+          } /* Add */
+
+          /* Waits clearing function */
+          VOID Clear( VOID )
+          {
+            Semaphores.clear();
+            Values.clear();
+            Stages.clear();
+          } /* Clear */
+        }; /* frame_waits */
+
+        frame_waits TraceWaits;                  // waits of next frame raytracing (device vertex writes of other queues, uploads), guarded by SubmitMutex
+        BOOL IsDeviceGeometryWritten = FALSE;    // are vertices rewritten on device since last scene update, guarded by SubmitMutex
+
         VkQueue GraphicsQueue = VK_NULL_HANDLE;
         VkQueue PresentQueue = VK_NULL_HANDLE;
         VkQueue TransferQueue = VK_NULL_HANDLE;
         VkQueue ComputeQueue = VK_NULL_HANDLE;
 
-        VkCommandPool GraphicsCommandPool = VK_NULL_HANDLE;
-        VkCommandPool TransferCommandPool = VK_NULL_HANDLE;
-        VkCommandPool ComputeCommandPool = VK_NULL_HANDLE;
+        VkCommandPool GraphicsCommandPool = VK_NULL_HANDLE; // pool of long living graphics command buffers
+        VkCommandPool ComputeCommandPool = VK_NULL_HANDLE;  // pool of long living compute command buffers
+
+        /* One-shot command allocators of one thread */
+        struct thread_command_allocators
+        {
+          transient_command_allocator Graphics; // single time commands
+          transient_command_allocator Transfer; // transfers
+        }; /* thread_command_allocators */
+
+        std::mutex ThreadCommandAllocatorsMutex; // guards allocators map only, allocators are used by their threads without locking
+        std::map<std::thread::id, std::unique_ptr<thread_command_allocators>> ThreadCommandAllocators;
+        UINT64 ThreadCommandAllocatorsGeneration = GetNextAllocatorsGeneration(); // unique over process, keys thread caches of allocators map
+        std::recursive_mutex SubmitMutex;        // serializes queue submissions and timeline values of threads
+
+        VkSemaphore TransferTimeline = VK_NULL_HANDLE; // signaled by every transfer queue submission
+        UINT64 TransferTimelineValue = 0;              // value of last transfer submission
+        UINT64 GraphicsTransferWaitValue = 0;          // transfer value, which graphics queue already waits for
+        VkSemaphore GraphicsTimeline = VK_NULL_HANDLE; // signaled by single time graphics submissions and frame raytracing
+        UINT64 GraphicsTimelineValue = 0;              // value of last single time graphics submission
+        VkSemaphore TraceTimeline = VK_NULL_HANDLE;    // signaled by frame raytracing submissions, waited by post processing
+        VkSemaphore PostTimeline = VK_NULL_HANDLE;     // signaled by post processing submissions
+        UINT64 PostValue = 0;                          // value of last post processing submission on both trace and post timelines
+        UINT64 PresentedPostValue = 0;                 // post timeline value of post image presented by last frame
+        UINT64 PostResetValue = 0;                     // post timeline value, results up to which are lost (on resize)
+
+        std::vector<VkBufferMemoryBarrier> PendingBufferAcquires; // ownership acquires of buffers released by transfer queue
+        std::vector<VkImageMemoryBarrier> PendingImageAcquires;   // ownership acquires of images released by transfer queue
+
+        /* Object waiting for device to finish using it */
+        struct retired_object
+        {
+          SIZE_T Frame = 0;                      // number of frames, which must be finished before destruction
+          UINT64 TransferValue = 0;              // transfer timeline value, which must be reached before destruction
+          std::function<VOID( VOID )> Destroy;   // destruction function
+        }; /* retired_object */
+
+        std::deque<retired_object> RetireQueue; // deferred destruction queue (in retirement order)
 
         VkSwapchainKHR Swapchain = VK_NULL_HANDLE;
+        present_policy PresentPolicy;                             // current presentation policy
+        VkPresentModeKHR PresentMode = VK_PRESENT_MODE_FIFO_KHR; // present mode of swapchain
+        BOOL IsSwapchainOutdated = FALSE;                        // must swapchain be recreated by next frame
+        BOOL IsResizeRequested = FALSE;                          // must surface extent be checked by next frame
+        BOOL IsSurfaceEmpty = FALSE;                             // has surface zero extent (minimized window), so frames aren't rendered
         VkExtent2D SwapchainImageExtent;
         VkFormat SwapchainImageFormat;
         std::vector<VkImage> SwapchainImages;
@@ -489,20 +1285,20 @@ namespace vrt
         /* image creating function */
         image CreateImage( UINT32 Width, UINT32 Height, VkFormat Format, VkImageTiling Tiling, VkImageUsageFlags UsageFlags, VkMemoryPropertyFlags MemoryProperties );
 
-        /* image layout transfering function */
-        VOID TransferImageLayout( image &Image, VkImageLayout OldLayout, VkImageLayout NewLayout );
+        /* image layout transfering function (asynchronous, on transfer queue) */
+        upload_ticket TransferImageLayout( image &Image, VkImageLayout OldLayout, VkImageLayout NewLayout );
 
         /* image view creating function */
         VkImageView CreateImageView( VkImage Image, VkFormat ImageFormat );
 
         /* command buffer creating function */
-        VkCommandBuffer CreateCommandBuffer( VkCommandPool CommandPool );
+        VkCommandBuffer CreateCommandBuffer( VkCommandPool CommandPool, VkCommandBufferLevel Level = VK_COMMAND_BUFFER_LEVEL_PRIMARY );
 
         /* Memory type choosing function */
         UINT32 FindMemoryType( UINT32 TypeFilter, VkMemoryPropertyFlags PropertyFlags );
 
         /* buffer creating function */
-        buffer CreateBuffer( VkDeviceSize Size, VkBufferUsageFlags Usage, VkMemoryPropertyFlags MemoryPropertyFlags );
+        buffer CreateBuffer( VkDeviceSize Size, VkBufferUsageFlags Usage, VkMemoryPropertyFlags MemoryPropertyFlags, VkMemoryPropertyFlags PreferredMemoryPropertyFlags = 0 );
 
         VkCommandBuffer BeginSingleTimeCommands( VOID );
 
@@ -510,7 +1306,69 @@ namespace vrt
 
         VkCommandBuffer BeginTransfer( VOID );
 
-        VOID EndTransfer( VkCommandBuffer CommandBuffer );
+        /* Transfer submitting function. Doesn't wait for commands to finish, returns ticket to wait on. */
+        upload_ticket EndTransfer( VkCommandBuffer CommandBuffer );
+
+        /* Timeline semaphores initialization function */
+        VOID InitializeTimelines( VOID );
+
+        /* Timeline semaphores deinitialization function */
+        VOID CloseTimelines( VOID );
+
+        /* Timeline semaphore creating function */
+        VkSemaphore CreateTimelineSemaphore( VOID );
+
+        /* Upload completion checking function */
+        BOOL IsUploadComplete( upload_ticket Ticket );
+
+        /* Upload completion waiting function (blocks host) */
+        VOID WaitUpload( upload_ticket Ticket );
+
+        /* Finished one-shot command pools of calling thread recycling function (doesn't block) */
+        VOID RetireTransfers( VOID );
+
+        /* Unique allocators map generation getting function. Kernel address may be reused, so thread caches are keyed by generation. */
+        static UINT64 GetNextAllocatorsGeneration( VOID );
+
+        /* One-shot command allocators of calling thread getting function */
+        thread_command_allocators & GetThreadCommandAllocators( VOID );
+
+        /* One-shot command allocators of all threads deinitialization function. Device must be idle. */
+        VOID CloseThreadCommandAllocators( VOID );
+
+        /* Transfer wait for graphics submission getting function. Returns FALSE if graphics queue already waits for all submitted uploads. */
+        BOOL GetGraphicsTransferWait( UINT64 &WaitValue );
+
+        /* Ownership transfer between graphics and compute queue families requirement checking function */
+        BOOL IsPostOwnershipTransferRequired( VOID ) const
+        {
+          return QueueFamilies.Compute != QueueFamilies.Graphics;
+        } /* IsPostOwnershipTransferRequired */
+
+        /* Ownership transfer between transfer and graphics queue families requirement checking function */
+        BOOL IsOwnershipTransferRequired( VOID ) const
+        {
+          return QueueFamilies.Transfer != QueueFamilies.Graphics;
+        } /* IsOwnershipTransferRequired */
+
+        /* Buffer range ownership releasing to graphics queue function. Range must be written by transfer commands only. */
+        VOID ReleaseToGraphics( VkCommandBuffer TransferCommandBuffer, VkBuffer Buffer, VkDeviceSize Offset, VkDeviceSize Size );
+
+        /* Image ownership releasing to graphics queue function. Barrier layouts and source access are kept, queue families are set. */
+        VOID ReleaseToGraphics( VkCommandBuffer TransferCommandBuffer, VkImageMemoryBarrier Barrier, VkPipelineStageFlags SourceStageFlags );
+
+        /* Pending ownership acquires checking function */
+        BOOL IsAcquirePending( VOID ) const
+        {
+          return !PendingBufferAcquires.empty() || !PendingImageAcquires.empty();
+        } /* IsAcquirePending */
+
+        /* Pending ownership acquires recording function. Command buffer must be submitted to graphics queue with wait from GetGraphicsTransferWait. */
+        VOID RecordAcquires( VkCommandBuffer GraphicsCommandBuffer );
+
+        /* Pending ownership acquires of destroyed resource dropping functions */
+        VOID DiscardAcquires( VkBuffer Buffer );
+        VOID DiscardAcquires( VkImage Image );
 
         /* raytracing shader loading function */
         rt_shader LoadRTShader( std::string_view Name );
@@ -530,15 +1388,76 @@ namespace vrt
         /* Buffer destroying function */
         VOID Destroy( buffer &Buffer );
 
-        /* Resize function */
+        /* Headless rendering checking function. There are no surface, swapchain and presentation - results are read back from target image. */
+        BOOL IsHeadless( VOID ) const
+        {
+          return Window == nullptr;
+        } /* IsHeadless */
+
+        /* Target image saving function. Accumulated target is read back, tone mapped and saved to file (blocks host). */
+        BOOL SaveTarget( std::string_view FileName );
+
+        /* Resize function. Doesn't wait for device - old swapchain, target and descriptor sets are retired. */
         VOID Resize( VOID );
 
+        /* Resize requesting function. Events are coalesced, swapchain is recreated by next frame only if surface extent is changed. */
+        VOID RequestResize( VOID )
+        {
+          IsResizeRequested = TRUE;
+        } /* RequestResize */
+
+        /* Swapchain updating function. Returns FALSE if there is nothing to render to (e.g. window is minimized). */
+        BOOL UpdateSwapchain( VOID );
+
+        /* Rendering pause checking function. Frames aren't rendered until surface gets nonzero extent (window is restored). */
+        BOOL IsPaused( VOID ) const
+        {
+          return IsSurfaceEmpty;
+        } /* IsPaused */
+
+        /* Surface extent getting function */
+        VkExtent2D GetSurfaceExtent( const VkSurfaceCapabilitiesKHR &Capabilities );
+
+        /* Descriptor set replacing function. Descriptors are copied to set allocated from new pool, old pool is retired. Pool sizes are listed in binding order. */
+        VOID ReplaceDescriptorSet( VkDescriptorPool &Pool, VkDescriptorSet &Set, VkDescriptorSetLayout Layout, std::span<const VkDescriptorPoolSize> PoolSizes );
+
+        /* Deferred destruction function. Destroy is called after device finishes all work submitted before this call. */
+        VOID Retire( std::function<VOID( VOID )> &&Destroy );
+
+        /* Buffer deferred destroying function */
+        VOID Retire( buffer &Buffer );
+
+        /* Image deferred destroying function */
+        VOID Retire( image &Image );
+
+        /* Retired objects, which aren't used by device anymore, destroying function (doesn't block) */
+        VOID CollectRetired( VOID );
+
+        /* All retired objects destroying function. Device must be idle. */
+        VOID FlushRetired( VOID );
+
+        /* Released resources of one type retiring function */
+        template <typename resource_type, typename index_type>
+          VOID RetireFree( VOID )
+          {
+            auto List = manager<resource_type, index_type>::DetachFree();
+
+            if (!List.IsEmpty())
+              Retire([this, List]( VOID ) { manager<resource_type, index_type>::FlushFree(List); });
+          } /* RetireFree */
+
         /* ... */
 
         image TargetImage;
-        buffer PresentBuffer;
+
+        static constexpr UINT32 PostImageCount = 2; // frame processes one post image while previous frame result is presented from other
+
+        std::array<image, PostImageCount> PostImages; // post processed snapshots of target image, indexed by post timeline value % PostImageCount
+        std::array<FLOAT, PostImageCount> PostInputTimes {NAN, NAN}; // global time of input, post image is rendered with (NAN - image is already presented)
+        VkPipeline PostPipeline = VK_NULL_HANDLE;     // post processing compute pipeline, uses presentation pipeline layout
 
         BOOL DoPresentCollection = FALSE;
+        UINT32 CollectionFrameCount = 0;
 
         VkSampler TargetImageSampler = VK_NULL_HANDLE;
         VkRenderPass PresentRenderPass = VK_NULL_HANDLE;
@@ -547,9 +1466,103 @@ namespace vrt
         VkDescriptorPool PresentDescriptorPool = VK_NULL_HANDLE;
         VkPipelineLayout PresentPipelineLayout = VK_NULL_HANDLE;
         VkPipeline PresentPipeline = VK_NULL_HANDLE;
-        VkCommandBuffer GraphicsCommandBuffer = VK_NULL_HANDLE;
-        VkFence InFlightFence = VK_NULL_HANDLE;
-        VkSemaphore ImageAvailableSemaphore = VK_NULL_HANDLE, RenderFinishedSemaphore = VK_NULL_HANDLE;
+
+        // descriptor pool sizes, listed in binding order
+        static constexpr VkDescriptorPoolSize PresentDescriptorPoolSizes[]
+        {
+          { .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          .descriptorCount = PostImageCount, },
+          { .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, .descriptorCount = 1, },
+        };
+        static constexpr VkDescriptorPoolSize SceneDescriptorPoolSizes[]
+        {
+          { .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,              .descriptorCount = 1, },
+          { .type = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, .descriptorCount = 1, },
+          { .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,     .descriptorCount = 1, },
+          { .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,             .descriptorCount = 1, },
+        };
+
+        /* Frame in flight data */
+        struct frame
+        {
+          VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;           // per frame commands (ownership acquires, scene updates)
+          VkCommandBuffer PostCommandBuffer = VK_NULL_HANDLE;       // target image copying to post image, submitted after raytracing
+          VkCommandBuffer ComputeCommandBuffer = VK_NULL_HANDLE;    // post processing commands, submitted to compute queue
+          VkCommandBuffer PresentCommandBuffer = VK_NULL_HANDLE;    // presented post image ownership acquire, submitted before presentation
+          UINT64 PostValue = 0;                                     // post timeline value of last post processing of this data
+          VkFence InFlightFence = VK_NULL_HANDLE;                   // signaled when frame commands are finished
+          VkSemaphore ImageAvailableSemaphore = VK_NULL_HANDLE;     // signaled when swapchain image is acquired
+          VkSemaphore RenderFinishedSemaphore = VK_NULL_HANDLE;     // signaled when frame is ready to present
+          SIZE_T SubmittedFrame = 0;                                // number of frames submitted up to last use of this data
+          FLOAT InputTime = NAN;                                    // global time of input, image presented by frame is rendered with (NAN - no latency sample pending)
+        }; /* frame */
+
+        std::array<frame, MaxFramesInFlight> Frames; // frame in flight data, indexed by CurrentFrame % FramesInFlight
+
+        /* Pre-recorded frame commands */
+        struct frame_commands
+        {
+          VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;        // raytracing commands
+          VkCommandBuffer PresentCommandBuffer = VK_NULL_HANDLE; // presentation commands
+          std::vector<VkCommandBuffer> PassCommandBuffers;       // secondary command buffers of frame passes
+          UINT32 GlobalBufferOffset = 0;                         // dynamic offset of global uniform data commands are recorded with
+          UINT32 PresentBufferOffset = 0;                        // dynamic offset of present uniform data commands are recorded with
+          BOOL IsValid = FALSE;                                  // are commands recorded for current scene and swapchain
+        }; /* frame_commands */
+
+        std::vector<frame_commands> FrameCommands;      // frame commands, indexed by ImageIndex * MaxFramesInFlight + frame data index
+        scene *FrameCommandsScene = nullptr;            // scene frame commands are recorded for
+
+        recording_scheduler RecordingScheduler; // frame passes recording scheduler
+        readback_ring ReadbackRing;             // asynchronous target image readback
+        frame_encoder FrameEncoder;             // read back frames saving threads
+
+        /* Target image capture requesting function. Target is copied after one of next frames, resolved and saved by encoder threads (doesn't block). */
+        VOID CaptureTarget( std::string_view FileName )
+        {
+          ReadbackRing.Request(FileName);
+        } /* CaptureTarget */
+
+        /* Immediate capture checking function. Returns TRUE if capture requested now is made after next frame. */
+        BOOL IsCaptureAvailable( VOID )
+        {
+          return ReadbackRing.IsAvailable();
+        } /* IsCaptureAvailable */
+
+        /* Accumulation restarting function. Next frame is first accumulated one. */
+        VOID ResetCollection( VOID )
+        {
+          CollectionFrameCount = 0;
+        } /* ResetCollection */
+
+        /* Finished frames latency reporting function. Doesn't block. */
+        VOID ResponseLatency( VOID );
+
+        /* Frame commands recording function */
+        VOID RecordFrameCommands( frame_commands &Commands, UINT32 ImageIndex, UINT32 FrameSlot, UINT32 GlobalBufferOffset, UINT32 PresentBufferOffset );
+
+        /* Frame commands getting function. Commands are re-recorded only if they are invalidated or uniform offsets are changed. */
+        frame_commands & GetFrameCommands( UINT32 ImageIndex, UINT32 FrameSlot, UINT32 GlobalBufferOffset, UINT32 PresentBufferOffset );
+
+        /* Frame commands invalidation function. Must be called on scene, SBT, pipeline or swapchain change. */
+        VOID InvalidateFrameCommands( VOID );
+
+        /* Frame commands freeing function. Device must not use them. */
+        VOID DestroyFrameCommands( VOID );
+
+        /* Post images initialization function */
+        VOID InitializePostImages( VOID );
+
+        /* Post images destruction function. Device must not use them. */
+        VOID DestroyPostImages( VOID );
+
+        /* Post images presentation descriptors writing function */
+        VOID WritePostDescriptors( VOID );
+
+        /* Post processing commands recording function. Returns TRUE if presented image acquire is recorded into frame present command buffer. */
+        BOOL RecordPost( frame &Frame, UINT32 PostImageIndex, UINT32 PresentImageIndex, BOOL DoAcquirePresentImage, UINT32 PresentBufferOffset );
+
+        /* Post processing finish waiting function (blocks host) */
+        VOID WaitPost( UINT64 Value );
 
         scene *Scene = nullptr;
 
@@ -579,151 +1592,120 @@ namespace vrt
 
             Primitive->TrasnformMatrix = TransformMatrix;
             /* initialize buffers */
-            Primitive->VertexBuffer = CreateBuffer(Vertices.size_bytes(),
-              VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
-              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-            Primitive->VertexBuffer.WriteData(Vertices.data(), Vertices.size_bytes());
+            if (DoUseGeometryPool)
+            {
+              Primitive->VertexRange = GeometryPool.Allocate(Vertices.size_bytes());
+              GeometryPool.GetBuffer(Primitive->VertexRange).WriteData(Vertices.data(), Vertices.size_bytes(), Primitive->VertexRange.Offset);
+            }
+            else
+            {
+              Primitive->VertexBuffer = CreateBuffer(Vertices.size_bytes(),
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+              Primitive->VertexBuffer.WriteData(Vertices.data(), Vertices.size_bytes());
+            }
             Primitive->VertexCount = Vertices.size();
 
             if (Indices.size() != 0)
             {
-              Primitive->IndexBuffer = CreateBuffer(Indices.size_bytes(),
-                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-              Primitive->IndexBuffer.WriteData(Indices.data(), Indices.size_bytes());
+              if (DoUseGeometryPool)
+              {
+                Primitive->IndexRange = GeometryPool.Allocate(Indices.size_bytes());
+                GeometryPool.GetBuffer(Primitive->IndexRange).WriteData(Indices.data(), Indices.size_bytes(), Primitive->IndexRange.Offset);
+              }
+              else
+              {
+                Primitive->IndexBuffer = CreateBuffer(Indices.size_bytes(),
+                  VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
+                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+                Primitive->IndexBuffer.WriteData(Indices.data(), Indices.size_bytes());
+              }
               Primitive->IndexCount = Indices.size();
             }
 
             Primitive->VertexSize = sizeof(vertex_type);
             Primitive->VertexPositionComponentOffset = PositionComponentOffset;
+            Primitive->EvaluateBounds(Vertices.data());
 
             return Primitive;
           } /* CreatePrimitive */
 
+        /* Primitive vertices rewriting function. Layout and count of vertices are kept, BLASes of dynamic models are refitted by next frame (doesn't block). */
+        template <typename vertex_type>
+          VOID UpdatePrimitive( primitive *Primitive, std::span<const vertex_type> Vertices )
+          {
+            utils::Assert(sizeof(vertex_type) == Primitive->VertexSize && Vertices.size() == Primitive->VertexCount, "primitive vertex layout can't be changed");
+
+            WritePrimitiveVertices(Primitive, Vertices.data(), Vertices.size_bytes());
+          } /* UpdatePrimitive */
+
+        /* Primitive vertex data rewriting function. Data is staged now and copied before next frame raytracing, so frames in flight aren't affected. */
+        VOID WritePrimitiveVertices( primitive *Primitive, const VOID *Vertices, SIZE_T Size );
+
+        /* Models creating function. Bottom level acceleration structures of all models are built by one command with shared scratch buffer (blocks host). */
+        std::vector<model *> CreateModels( std::span<const model_description> Descriptions );
+
         /* @brief Model creating function.
          * @param[in] std::span<primitive *> Primitives - array of that this model include
          * @param[in] mat4 TransformMatrix - Model transformation matrix
          */
         model * CreateModel( std::span<primitive *> Primitives, mat4 TransformMatrix = mat4::Identity() )
         {
-          model *Model = manager<model>::CreateResource();
-
-          for (primitive *Prim : Primitives)
-            Prim->Grab();
-          Model->Primitives = {Primitives.begin(), Primitives.end()};
-
-          Model->Kernel = this;
-            
-          Model->TransformMatrix = TransformMatrix;
-          /* initialize buffers */
-
-          std::vector<VkAccelerationStructureGeometryKHR> Geometries {Primitives.size()};
-
-          for (UINT32 i = 0; i < Geometries.size(); i++)
-          {
-            Geometries[i] = VkAccelerationStructureGeometryKHR 
-            {
-              /* VkStructureType                        */ .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
-              /* const void*                            */ .pNext = nullptr,
-              /* VkGeometryTypeKHR                      */ .geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR,
-              /* VkAccelerationStructureGeometryDataKHR */ .geometry = {},
-              /* VkGeometryFlagsKHR                     */ .flags = VK_GEOMETRY_OPAQUE_BIT_KHR,
-            };
+          model_description Description {Primitives, TransformMatrix};
 
-            VkAccelerationStructureGeometryTrianglesDataKHR &TrianglesData = Geometries[i].geometry.triangles;
-            TrianglesData = VkAccelerationStructureGeometryTrianglesDataKHR
-            {
-              /* VkStructureType               */ .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR,
-              /* const void*                   */ .pNext = nullptr,
-              /* VkFormat                      */ .vertexFormat = VK_FORMAT_R32G32B32_SFLOAT,
-              /* VkDeviceOrHostAddressConstKHR */ .vertexData = { .deviceAddress = Primitives[i]->VertexBuffer.GetDeviceAddress() + Primitives[i]->VertexPositionComponentOffset },
-              /* VkDeviceSize                  */ .vertexStride = Primitives[i]->VertexSize,
-              /* uint32_t                      */ .maxVertex = (UINT32)Primitives[i]->VertexCount,
-              /* VkIndexType                   */ // .indexType = VK_INDEX_TYPE_UINT32,
-              /* VkDeviceOrHostAddressConstKHR */ // .indexData = Primitive->IndexCount != 0 ? { .deviceAddress = Primitive->IndexBuffer.GetDeviceAddress() } : {},
-              /* VkDeviceOrHostAddressConstKHR */ .transformData {},
-            };
-
-            if (Primitives[i]->IndexCount != 0)
-            {
-              TrianglesData.indexType = VK_INDEX_TYPE_UINT32;
-              TrianglesData.indexData = { .deviceAddress = Primitives[i]->IndexBuffer.GetDeviceAddress() };
-            }
-            else
-            {
-              TrianglesData.indexType = VK_INDEX_TYPE_NONE_KHR;
-              TrianglesData.indexData = {};
-            }
-          }
+          return CreateModels({&Description, 1})[0];
+        } /* CreateModel */
 
-          VkAccelerationStructureBuildGeometryInfoKHR GeometryBuildInfo
-          {
-            /* VkStructureType                                  */ .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
-            /* const void*                                      */ .pNext = nullptr,
-            /* VkAccelerationStructureTypeKHR                   */ .type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
-            /* VkBuildAccelerationStructureFlagsKHR             */ .flags = VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR,
-            /* VkBuildAccelerationStructureModeKHR              */ .mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
-            /* VkAccelerationStructureKHR                       */ .srcAccelerationStructure = VK_NULL_HANDLE,
-            /* VkAccelerationStructureKHR                       */ .dstAccelerationStructure = VK_NULL_HANDLE,
-            /* uint32_t                                         */ .geometryCount = (UINT32)Geometries.size(),
-            /* const VkAccelerationStructureGeometryKHR*        */ .pGeometries = Geometries.data(),
-            /* const VkAccelerationStructureGeometryKHR* const* */ .ppGeometries = nullptr,
-            /* VkDeviceOrHostAddressKHR                         */ .scratchData = 0,
-          };
+        /* Built models bottom level acceleration structures compacting function. Query pool contains compacted sizes of models in order (blocks host). */
+        VOID CompactModels( std::span<model *> Models, VkQueryPool QueryPool );
 
-          std::vector<UINT32> GeometryPrimitiveCounts;
+        /* Scene instances writing function. Instances are written to region of instance buffer (frame data index), which device doesn't use. */
+        VOID WriteSceneInstances( scene *Scene, UINT32 Region );
 
-          GeometryPrimitiveCounts.resize(Primitives.size());
-          for (UINT32 i = 0; i < GeometryPrimitiveCounts.size(); i++)
-            GeometryPrimitiveCounts[i] = (UINT32)std::max<SIZE_T>(Primitives[i]->VertexCount, Primitives[i]->IndexCount) / 3;
+        /* Scene top level acceleration structure geometry getting function. Instances are read from region of instance buffer. */
+        VkAccelerationStructureGeometryKHR GetSceneGeometry( const scene *Scene, UINT32 Region );
 
-          VkAccelerationStructureBuildSizesInfoKHR BuildSizesInfo {VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR};
+        /* Scene update requirement checking function. Returns TRUE if some model or instance of scene is moved or deformed. */
+        BOOL IsSceneUpdateRequired( const scene *Scene ) const;
 
-          vkGetAccelerationStructureBuildSizesKHR(Device, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &GeometryBuildInfo, GeometryPrimitiveCounts.data(), &BuildSizesInfo);
-          Model->BLASStorageBuffer = CreateBuffer(BuildSizesInfo.accelerationStructureSize, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        /* Scene update recording function. Instances are rewritten and TLAS is updated in place or rebuilt before raytracing (doesn't block). */
+        VOID RecordSceneUpdate( scene *Scene, VkCommandBuffer CommandBuffer, UINT32 FrameSlot );
 
-          VkAccelerationStructureCreateInfoKHR AccelerationStructureCreateInfo
-          {
-            /* VkStructureType                       */ .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR,
-            /* const void*                           */ .pNext = nullptr,
-            /* VkAccelerationStructureCreateFlagsKHR */ .createFlags = 0,
-            /* VkBuffer                              */ .buffer = Model->BLASStorageBuffer.Buffer,
-            /* VkDeviceSize                          */ .offset = 0,
-            /* VkDeviceSize                          */ .size = BuildSizesInfo.accelerationStructureSize,
-            /* VkAccelerationStructureTypeKHR        */ .type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
-            /* VkDeviceAddress                       */ .deviceAddress = 0,
-          };
+        /* Device vertex write registering function. Next frame scene update makes shader writes visible to builds and waits for timeline value (if any). */
+        VOID AddGeometryWrite( VkSemaphore WriteTimeline, UINT64 WriteValue );
 
-          std::vector<VkAccelerationStructureBuildRangeInfoKHR> BuildRangeInfos {Primitives.size()};
+        /* Buffers used by recorded frame (replaced scratch storages) retiring function.
+         * Called after frame counter is advanced, so submitted frame is waited for.
+         */
+        VOID RetireRecordedBuffers( VOID );
 
-          for (UINT32 i = 0; i < BuildRangeInfos.size(); i++)
-            BuildRangeInfos[i] = VkAccelerationStructureBuildRangeInfoKHR
-            {
-              .primitiveCount = GeometryPrimitiveCounts[i],
-              .primitiveOffset = 0,
-              .firstVertex = 0,
-              .transformOffset = 0,
-            };
+        /* Changed geometry of dynamic scene models BLASes refitting function. BLASes are rebuilt if they are refitted too many times or their bounds grow too much. */
+        VOID RecordModelRefits( scene *Scene, VkCommandBuffer CommandBuffer );
 
-          vkCreateAccelerationStructureKHR(Device, &AccelerationStructureCreateInfo, nullptr, &Model->BLAS);
+        /* Model BLAS build flags getting function. Refits must use flags of build. */
+        VkBuildAccelerationStructureFlagsKHR GetModelBuildFlags( const model *Model ) const
+        {
+          if (Model->IsDynamic)
+            return VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR;
+          return VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | (DoCompactBLAS ? VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR : 0);
+        } /* GetModelBuildFlags */
 
-          GeometryBuildInfo.dstAccelerationStructure = Model->BLAS;
-          buffer ScratchBuffer = CreateBuffer(BuildSizesInfo.buildScratchSize, VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-          GeometryBuildInfo.scratchData.deviceAddress = ScratchBuffer.GetDeviceAddress();
+        /* Model bottom level acceleration structure geometries getting function. Range infos are filled for every geometry. */
+        std::vector<VkAccelerationStructureGeometryKHR> GetModelGeometries( const model *Model, std::vector<VkAccelerationStructureBuildRangeInfoKHR> &RangeInfos );
 
-          // building acceleration buffer
-          VkCommandBuffer CommandBuffer = BeginSingleTimeCommands();
-          VkAccelerationStructureBuildRangeInfoKHR *PtrRangeInfo = BuildRangeInfos.data();
-          vkCmdBuildAccelerationStructuresKHR(CommandBuffer, 1, &GeometryBuildInfo, &PtrRangeInfo);
-          EndSingleTimeCommands(CommandBuffer);
+        /* Scene building function. Every model is placed once. */
+        scene * CreateScene( const std::string &SceneName, std::span<model *> Models )
+        {
+          std::vector<instance> Instances {Models.size()};
 
-          Destroy(ScratchBuffer);
+          for (SIZE_T i = 0; i < Models.size(); i++)
+            Instances[i].Model = Models[i];
 
-          return Model;
-        } /* CreateModel */
+          return CreateScene(SceneName, Models, Instances);
+        } /* CreateScene */
 
-        /* Scene building function */
-        scene * CreateScene( const std::string &SceneName, std::span<model *> Models )
+        /* Scene building function. Models define hit groups, instances place them (model may have any number of instances). */
+        scene * CreateScene( const std::string &SceneName, std::span<model *> Models, std::span<const instance> Instances )
         {
           scene *Scene = manager<scene, std::string>::CreateResource(SceneName);
 
@@ -731,8 +1713,18 @@ namespace vrt
             Model->Grab();
           Scene->Models = {Models.begin(), Models.end()};
 
+          // mask and custom index are packed into 8 and 24 bits of TLAS instance
+          Scene->Instances = {Instances.begin(), Instances.end()};
+          for (instance &Instance : Scene->Instances)
+          {
+            auto ModelIter = std::find(Models.begin(), Models.end(), Instance.Model);
+
+            utils::Assert(ModelIter != Models.end(), "instanced model isn't scene model");
+            utils::Assert(Instance.Mask <= 0xFF && Instance.CustomIndex < (1 << 24), "instance mask or custom index is out of range");
+            Instance.ModelIndex = (UINT32)(ModelIter - Models.begin());
+          }
+
           Scene->Kernel = this;
-          Scene->GlobalBuffer = CreateBuffer(sizeof(global_buffer_data), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
 
           // Add first light
@@ -759,66 +1751,27 @@ namespace vrt
           Scene->LightStorageBuffer.WriteData(Scene->Lights.data(), sizeof(point_light) * Scene->Lights.size());
 
 
-          Scene->InstanceCount = Models.size();
+          Scene->InstanceCount = Instances.size();
 
-          // initialize 'vertex buffer' of TLAS
+          // initialize 'vertex buffer' of TLAS - every frame in flight has its own instances
           Scene->InstanceBuffer = CreateBuffer
           (
-            sizeof(VkAccelerationStructureInstanceKHR) * Models.size(),
+            sizeof(VkAccelerationStructureInstanceKHR) * Instances.size() * MaxFramesInFlight,
             VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
           );
 
-          VkAccelerationStructureInstanceKHR *InstanceData = reinterpret_cast<VkAccelerationStructureInstanceKHR *>(Scene->InstanceBuffer.MapMemory());
-
-          SIZE_T Offset = 0;
-          for (SIZE_T i = 0; i < Scene->InstanceCount; i++)
-          {
-            VkAccelerationStructureDeviceAddressInfoKHR DeviceAddressInfo
-            {
-              .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR,
-              .pNext = nullptr,
-              .accelerationStructure = Models[i]->BLAS,
-            };
-
-            VkDeviceAddress BLASAddres = vkGetAccelerationStructureDeviceAddressKHR(Device, &DeviceAddressInfo);
-
-            InstanceData[i] = VkAccelerationStructureInstanceKHR
-            {
-              .transform = Models[i]->TransformMatrix,
-              .instanceCustomIndex = 0,
-              .mask = 0xFF,
-              .instanceShaderBindingTableRecordOffset = (UINT32)Offset,
-              .flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR,
-              .accelerationStructureReference = BLASAddres,
-            };
-            Offset += Models[i]->Primitives.size();
-          }
-          Scene->InstanceBuffer.UnmapMemory();
-
-          VkAccelerationStructureGeometryInstancesDataKHR InstancesVk
-          {
-            .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR,
-            .pNext = nullptr,
-            .arrayOfPointers = VK_FALSE,
-            .data = { .deviceAddress = Scene->InstanceBuffer.GetDeviceAddress() },
-          };
+          WriteSceneInstances(Scene, 0);
 
-          VkAccelerationStructureGeometryKHR Geometry
-          {
-            .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
-            .pNext = nullptr,
-            .geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR,
-            .geometry = { .instances = InstancesVk },
-            .flags = 0,
-          };
+          VkAccelerationStructureGeometryKHR Geometry = GetSceneGeometry(Scene, 0);
 
           VkAccelerationStructureBuildGeometryInfoKHR BuildGeometryInfo
           {
             /* VkStructureType                                  */ .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
             /* const void*                                      */ .pNext = nullptr,
             /* VkAccelerationStructureTypeKHR                   */ .type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR,
-            /* VkBuildAccelerationStructureFlagsKHR             */ .flags = 0,
+            /* VkBuildAccelerationStructureFlagsKHR             */ .flags = VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR,
             /* VkBuildAccelerationStructureModeKHR              */ .mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
             /* VkAccelerationStructureKHR                       */ .srcAccelerationStructure = VK_NULL_HANDLE,
             /* VkAccelerationStructureKHR                       */ .dstAccelerationStructure = Scene->TLAS,
@@ -855,16 +1808,18 @@ namespace vrt
 
           utils::AssertResult(vkCreateAccelerationStructureKHR(Device, &CreateInfo, nullptr, &Scene->TLAS), "error building TLAS.");
 
+          // scratch sizes are kept for frame updates and rebuilds
+          Scene->TLASBuildScratchSize = BuildSizesInfo.buildScratchSize;
+          Scene->TLASUpdateScratchSize = BuildSizesInfo.updateScratchSize;
+
           BuildGeometryInfo.dstAccelerationStructure = Scene->TLAS;
-          buffer ScratchBuffer = CreateBuffer(BuildSizesInfo.buildScratchSize, VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-          BuildGeometryInfo.scratchData.deviceAddress = ScratchBuffer.GetDeviceAddress();
 
-          // build structure
+          // build structure, scene may be created by loader thread - frame scratch arena isn't used
+          buffer ScratchBuffer = ScratchArena.CreateStandalone({&Scene->TLASBuildScratchSize, 1}, {&BuildGeometryInfo.scratchData.deviceAddress, 1});
           VkCommandBuffer CommandBuffer = BeginSingleTimeCommands();
           VkAccelerationStructureBuildRangeInfoKHR *PtrRangeInfo = &RangeInfo;
           vkCmdBuildAccelerationStructuresKHR(CommandBuffer, 1, &BuildGeometryInfo, &PtrRangeInfo);
           EndSingleTimeCommands(CommandBuffer);
-
           Destroy(ScratchBuffer);
 
           // write pipeline and other shit
@@ -885,7 +1840,7 @@ namespace vrt
             },
             {
               .binding = 2,
-              .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+              .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
               .descriptorCount = 1,
               .stageFlags = VK_SHADER_STAGE_ALL,
             },
@@ -908,22 +1863,14 @@ namespace vrt
 
           utils::AssertResult(vkCreateDescriptorSetLayout(Device, &DescriptorSetLayoutCreateInfo, nullptr, &Scene->DescriptorSetLayout), "error creating descriptor set layout.");
 
-          VkDescriptorPoolSize PoolSizes[]
-          {
-            { .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,              .descriptorCount = 1, },
-            { .type = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, .descriptorCount = 1, },
-            { .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,             .descriptorCount = 1, },
-            { .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,             .descriptorCount = 1, },
-          };
-
           VkDescriptorPoolCreateInfo DescriptorPoolCreateInfo
           {
             /* VkStructureType             */ .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
             /* const void*                 */ .pNext = nullptr,
             /* VkDescriptorPoolCreateFlags */ .flags = 0,
             /* uint32_t                    */ .maxSets = 1,
-            /* uint32_t                    */ .poolSizeCount = (UINT32)std::size(PoolSizes),
-            /* const VkDescriptorPoolSize* */ .pPoolSizes = PoolSizes,
+            /* uint32_t                    */ .poolSizeCount = (UINT32)std::size(SceneDescriptorPoolSizes),
+            /* const VkDescriptorPoolSize* */ .pPoolSizes = SceneDescriptorPoolSizes,
           };
 
           utils::AssertResult(vkCreateDescriptorPool(Device, &DescriptorPoolCreateInfo, nullptr, &Scene->DescriptorPool), "error creating descriptor pool.");
@@ -954,9 +1901,9 @@ namespace vrt
           };
           VkDescriptorBufferInfo GlobalBufferInfo
           {
-            .buffer = Scene->GlobalBuffer.Buffer,
+            .buffer = UniformRing.GetBuffer(),
             .offset = 0,
-            .range = Scene->GlobalBuffer.Size,
+            .range = sizeof(global_buffer_data),
           };
           VkDescriptorBufferInfo LightStorageBufferInfo
           {
@@ -1002,7 +1949,7 @@ namespace vrt
               /* uint32_t                      */ .dstBinding = 2,
               /* uint32_t                      */ .dstArrayElement = 0,
               /* uint32_t                      */ .descriptorCount = 1,
-              /* VkDescriptorType              */ .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+              /* VkDescriptorType              */ .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
               /* const VkDescriptorImageInfo*  */ .pImageInfo = nullptr,
               /* const VkDescriptorBufferInfo* */ .pBufferInfo = &GlobalBufferInfo,
               /* const VkBufferView*           */ .pTexelBufferView = nullptr,
@@ -1179,8 +2126,8 @@ namespace vrt
               UINT32 VertexSize;
             } *PrimitiveInfo = reinterpret_cast<primitive_info *>(Data + (p + 2) * Scene->SBTAlignedGroupSize + GroupHandleSize);
 
-            PrimitiveInfo->VertexBufferPtr = Primitives[p]->VertexBuffer.GetDeviceAddress();
-            PrimitiveInfo->IndexBufferPtr = Primitives[p]->IndexCount == 0 ? 0 : Primitives[p]->IndexBuffer.GetDeviceAddress();
+            PrimitiveInfo->VertexBufferPtr = Primitives[p]->GetVertexAddress();
+            PrimitiveInfo->IndexBufferPtr = Primitives[p]->GetIndexAddress();
             PrimitiveInfo->VertexSize = static_cast<UINT32>(Primitives[p]->VertexSize);
           }
 
@@ -1188,7 +2135,10 @@ namespace vrt
 
           SBTStagingBuffer.CopyTo(Scene->SBTStorageBuffer);
 
-          Destroy(SBTStagingBuffer);
+          Retire(SBTStagingBuffer);
+
+          // new pipeline and SBT
+          InvalidateFrameCommands();
 
           return Scene;
         } /* CreateScene */
@@ -1211,20 +2161,37 @@ namespace vrt
         } /* CreateInfo */
 
 
-        VOID Initialize( SDL_Window *RenderWindow )
+        /* Initialization function. Without window kernel renders headless into target image of HeadlessExtent. */
+        VOID Initialize( SDL_Window *RenderWindow, VkExtent2D HeadlessExtent = {800, 600} )
         {
           Window = RenderWindow;
+          SwapchainImageExtent = HeadlessExtent;
 
           volkInitialize();
           InitializeInstance();
 
-          utils::Assert(SDL_Vulkan_CreateSurface(Window, Instance, &Surface) == SDL_TRUE, "error initializing surface");
+          if (!IsHeadless())
+            utils::Assert(SDL_Vulkan_CreateSurface(Window, Instance, &Surface) == SDL_TRUE, "error initializing surface");
           InitializeDevice();
+          MemoryAllocator.Initialize(this, IsMemoryBudgetSupported);
           InitializeCommandPools();
+          RecordingScheduler.Initialize(this, std::clamp<UINT32>(std::thread::hardware_concurrency() / 2, 1, 4), MaxFramesInFlight);
+          FrameEncoder.Initialize(std::clamp<UINT32>(std::thread::hardware_concurrency() / 2, 1, 4), 8);
+          ReadbackRing.Initialize(this, &FrameEncoder, 3);
+          InitializeTimelines();
+          StagingRing.Initialize(this);
+          UploadBatch.Initialize(this);
+          GeometryPool.Initialize(this);
+          ScratchArena.Initialize(this);
+          UniformRing.Initialize(this, 64 * 1024, MaxFramesInFlight, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, PhysicalDeviceProperties.Properties.limits.minUniformBufferOffsetAlignment);
 
           InitializePresentResources();
-          InitializePresentPipeline();
+          if (!IsHeadless())
+            InitializePresentPipeline();
+
 
+          // scene geometry is uploaded in one batch
+          UploadBatch.Begin();
 
           ptr<material> PlaneMtl = CreateMaterial("Plane", "bin/shaders/plane");
           ptr<material> TriangleMtl = CreateMaterial("Triangle", "bin/shaders/triangle");
@@ -1250,17 +2217,28 @@ namespace vrt
 
           ptr<primitive> TrianglePrimitive = CreatePrimitive<vec3>(TriangleMtl, TriangleVtx, 0, {});
           primitive * WorldPrimitives[] {PlanePrimitive, TrianglePrimitive};
-          ptr<model> WorldModel = CreateModel(WorldPrimitives);
 
 
           topology CowTpl = topology::LoadOBJ("bin/models/cow.obj");
           ptr<primitive> CowPrimitive = CreatePrimitive<small_vertex>(CowMtl, CowTpl.Vertices, 0, CowTpl.Indices);
 
           primitive *CowPrimitives[] {CowPrimitive};
-          ptr<model> CowModel = CreateModel(CowPrimitives);
+
+          // acceleration structures of all models are built by one submission
+          model_description ModelDescriptions[]
+          {
+            {WorldPrimitives},
+            {CowPrimitives},
+          };
+          std::vector<model *> NewModels = CreateModels(ModelDescriptions);
+          ptr<model> WorldModel = NewModels[0];
+          ptr<model> CowModel = NewModels[1];
 
           model *Models[] {WorldModel, CowModel};
           Scene = CreateScene("Default", Models);
+          Scene->Camera.SetAspect((FLOAT)SwapchainImageExtent.width, (FLOAT)SwapchainImageExtent.height);
+
+          UploadBatch.End();
 
           VkFenceCreateInfo FenceCreateInfo
           {
@@ -1269,8 +2247,6 @@ namespace vrt
             .flags = VK_FENCE_CREATE_SIGNALED_BIT,
           };
 
-          utils::AssertResult(vkCreateFence(Device, &FenceCreateInfo, nullptr, &InFlightFence));
-
           VkSemaphoreCreateInfo SemaphoreCreateInfo
           {
             .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
@@ -1278,154 +2254,291 @@ namespace vrt
             .flags = 0,
           };
 
-          utils::AssertResult(vkCreateSemaphore(Device, &SemaphoreCreateInfo, nullptr, &ImageAvailableSemaphore));
-          utils::AssertResult(vkCreateSemaphore(Device, &SemaphoreCreateInfo, nullptr, &RenderFinishedSemaphore));
-
-          GraphicsCommandBuffer = CreateCommandBuffer(GraphicsCommandPool);
+          // data is created for maximal frame count, so frames in flight can be changed at any time
+          for (frame &Frame : Frames)
+          {
+            utils::AssertResult(vkCreateFence(Device, &FenceCreateInfo, nullptr, &Frame.InFlightFence));
+            utils::AssertResult(vkCreateSemaphore(Device, &SemaphoreCreateInfo, nullptr, &Frame.ImageAvailableSemaphore));
+            utils::AssertResult(vkCreateSemaphore(Device, &SemaphoreCreateInfo, nullptr, &Frame.RenderFinishedSemaphore));
+            Frame.CommandBuffer = CreateCommandBuffer(GraphicsCommandPool);
+            Frame.PostCommandBuffer = CreateCommandBuffer(GraphicsCommandPool);
+            Frame.PresentCommandBuffer = CreateCommandBuffer(GraphicsCommandPool);
+            Frame.ComputeCommandBuffer = CreateCommandBuffer(ComputeCommandPool);
+          }
         } /* Initialize */
 
+        /* Frames in flight count setting function. Count is clamped to [1, MaxFramesInFlight]. */
+        VOID SetFramesInFlight( UINT32 Count )
+        {
+          // every frame data has its own fence, so remapping frames to data is safe
+          FramesInFlight = std::clamp<UINT32>(Count, 1, MaxFramesInFlight);
+        } /* SetFramesInFlight */
+
+        /* Presentation policy setting function. Swapchain is recreated by next frame if present mode or image count is changed. */
+        VOID SetPresentPolicy( const present_policy &NewPolicy )
+        {
+          if (NewPolicy.PresentMode != PresentPolicy.PresentMode || NewPolicy.ImageCount != PresentPolicy.ImageCount)
+            IsSwapchainOutdated = TRUE;
+
+          PresentPolicy = NewPolicy;
+          SetFramesInFlight(NewPolicy.MaxQueuedFrames);
+        } /* SetPresentPolicy */
+
         VOID Render( VOID )
         {
-          // wait for rendering ended
-          VkFence RenderingFences[] {InFlightFence};
-          vkWaitForFences(Device, 1, &InFlightFence, VK_TRUE, UINT64_MAX);
-          vkResetFences(Device, 1, &InFlightFence);
+          // recycle finished uploads
+          StagingRing.Retire();
+          RetireTransfers();
 
-          // get image
-          UINT32 ImageIndex = UINT32_MAX;
-          VkResult result = vkAcquireNextImageKHR(Device, Swapchain, UINT64_MAX, ImageAvailableSemaphore, VK_NULL_HANDLE, &ImageIndex);
+          // window events are coalesced - swapchain is recreated once before frame and only if it is needed
+          if (!IsHeadless() && (IsSwapchainOutdated || IsResizeRequested))
+            if (!UpdateSwapchain())
+              return;
 
-          /* no image - no render. */
-          if (result != VK_SUCCESS)
-            return;
+          UINT32 FrameSlot = UINT32(CurrentFrame % FramesInFlight);
+          frame &Frame = Frames[FrameSlot];
 
-          vkResetCommandBuffer(GraphicsCommandBuffer, 0);
+          // wait for previous frame, which used this data, only - later frames keep rendering
+          vkWaitForFences(Device, 1, &Frame.InFlightFence, VK_TRUE, UINT64_MAX);
+          ResponseLatency();
 
-          /* Write output image to descriptor sets */
+          // post processing of frame is presented by next one, so it isn't covered by frame fence
+          WaitPost(Frame.PostValue);
+
+          // fence covers all previous submissions of queue - destroy objects finished frames could use
+          CompletedFrameCount = std::max(CompletedFrameCount, Frame.SubmittedFrame);
+          FlushFree();
+          CollectRetired();
+          MemoryAllocator.UpdateBudget();
 
-          VkCommandBufferBeginInfo CommandBufferBeginInfo
+          // get image (headless frame has no swapchain image, its commands use index 0)
+          UINT32 ImageIndex = 0;
+          if (!IsHeadless())
           {
-            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-            .pNext = nullptr,
-            .flags = 0,
-            .pInheritanceInfo = nullptr,
-          };
+            VkResult result = vkAcquireNextImageKHR(Device, Swapchain, UINT64_MAX, Frame.ImageAvailableSemaphore, VK_NULL_HANDLE, &ImageIndex);
 
-          global_buffer_data *BufferData = reinterpret_cast<global_buffer_data *>(Scene->GlobalBuffer.MapMemory());
-          *BufferData = global_buffer_data
+            // suboptimal image is still rendered and presented, swapchain is recreated by next frame
+            if (result == VK_SUBOPTIMAL_KHR || result == VK_ERROR_OUT_OF_DATE_KHR)
+              IsSwapchainOutdated = TRUE;
+
+            /* no image - no render. */
+            if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+              return;
+          }
+
+          // fence is reset only if frame will be submitted
+          vkResetFences(Device, 1, &Frame.InFlightFence);
+
+          // previous use of this slice is finished: frame data fence and post processing are waited
+          UniformRing.BeginFrame(FrameSlot);
+
+          // moved models invalidate accumulated image
+          BOOL DoUpdateScene = IsSceneUpdateRequired(Scene);
+          if (DoUpdateScene)
+            ResetCollection();
+
+          if (DoPresentCollection)
+            CollectionFrameCount++;
+          else
+            CollectionFrameCount = 1;
+
+          UINT32 GlobalBufferOffset = UniformRing.Push(global_buffer_data
           {
             .CameraLocation = Scene->Camera.Location,
             .LightNumber = (UINT32)Scene->Lights.size(),
             .CameraDirection = Scene->Camera.Direction,
-            .IsMoved = FALSE,
+            .IsMoved = CollectionFrameCount == 1, // accumulation restarts
             .CameraRight = Scene->Camera.Right,
             .FrameIndex = (UINT32)CurrentFrame,
             .CameraUp = Scene->Camera.Up,
             .WidthHeightNear = vec3(Scene->Camera.Width, Scene->Camera.Height, Scene->Camera.Near),
-          };
-          Scene->GlobalBuffer.UnmapMemory();
+          });
 
-          present_buffer_data *PresentBufferData = reinterpret_cast<present_buffer_data *>(PresentBuffer.MapMemory());
-          if (DoPresentCollection)
-            PresentBufferData->CollectionFrameCount++;
-          else
-            PresentBufferData->CollectionFrameCount = 1;
-          PresentBuffer.UnmapMemory();
+          // frame presents result of previous frame post processing, which overlaps with this frame raytracing
+          UINT64 FramePostValue = PostValue + 1;
+          UINT64 PresentValue = PostValue;
+          BOOL DoAcquirePresentImage = PresentValue > PresentedPostValue;
 
-          vkBeginCommandBuffer(GraphicsCommandBuffer, &CommandBufferBeginInfo);
+          // there is no previous result after resize - frame presents its own one
+          if (PostValue == PostResetValue)
+          {
+            PresentValue = FramePostValue;
+            DoAcquirePresentImage = TRUE;
+          }
 
-          vkCmdBindPipeline(GraphicsCommandBuffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, Scene->Pipeline);
-          vkCmdBindDescriptorSets(GraphicsCommandBuffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, Scene->PipelineLayout, 0, 1, &Scene->DescriptorSet, 0, nullptr);
+          UINT32 PostImageIndex = UINT32((FramePostValue - 1) % PostImageCount);
+          UINT32 PresentImageIndex = UINT32((PresentValue - 1) % PostImageCount);
 
-          VkStridedDeviceAddressRegionKHR RayGenRegion
+          UINT32 PresentBufferOffset = UniformRing.Push(present_buffer_data
           {
-            .deviceAddress = Scene->SBTStorageBuffer.GetDeviceAddress() + Scene->SBTAlignedGroupSize * 0,
-            .stride = Scene->SBTAlignedGroupSize,
-            .size = Scene->SBTAlignedGroupSize,
-          };
-          VkStridedDeviceAddressRegionKHR MissRegion
+            .CollectionFrameCount = CollectionFrameCount,
+            .PostImageIndex = PostImageIndex,
+            .PresentImageIndex = PresentImageIndex,
+          });
+
+          // frame commands differ by swapchain image and uniform offsets only, so they are recorded once
+          frame_commands &Commands = GetFrameCommands(ImageIndex, FrameSlot, GlobalBufferOffset, PresentBufferOffset);
+
+          // frame waits for uploads on device only if there are new ones
+          UINT64 TransferWaitValue = 0;
+          BOOL DoWaitTransfer = GetGraphicsTransferWait(TransferWaitValue);
+
+          // post processing is submitted to other queue, so pending acquires and submissions are kept consistent for other threads
+          std::lock_guard<std::recursive_mutex> SubmitLock(SubmitMutex);
+
+          // device vertex writes of other queues are already added to raytracing waits
+          if (DoWaitTransfer)
+            TraceWaits.Add(TransferTimeline, TransferWaitValue, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+          // uploaded resources are acquired and scene is updated by frame data command buffer submitted before frame commands
+          VkCommandBuffer CommandBuffers[3];
+          UINT32 CommandBufferCount = 0;
+
+          if (IsAcquirePending() || DoUpdateScene)
           {
-            .deviceAddress = Scene->SBTStorageBuffer.GetDeviceAddress() + Scene->SBTAlignedGroupSize * 1,
-            .stride = Scene->SBTAlignedGroupSize,
-            .size = Scene->SBTAlignedGroupSize,
+            VkCommandBufferBeginInfo CommandBufferBeginInfo
+            {
+              .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+              .pNext = nullptr,
+              .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+              .pInheritanceInfo = nullptr,
+            };
+
+            vkBeginCommandBuffer(Frame.CommandBuffer, &CommandBufferBeginInfo);
+            RecordAcquires(Frame.CommandBuffer);
+            if (DoUpdateScene)
+              RecordSceneUpdate(Scene, Frame.CommandBuffer, FrameSlot);
+            vkEndCommandBuffer(Frame.CommandBuffer);
+            CommandBuffers[CommandBufferCount++] = Frame.CommandBuffer;
+          }
+
+          CommandBuffers[CommandBufferCount++] = Commands.CommandBuffer;
+
+          // nothing is presented by headless frame, so target image stays as result and isn't post processed
+          BOOL IsPresentAcquireRecorded = FALSE;
+          if (!IsHeadless())
+          {
+            IsPresentAcquireRecorded = RecordPost(Frame, PostImageIndex, PresentImageIndex, DoAcquirePresentImage, PresentBufferOffset);
+            CommandBuffers[CommandBufferCount++] = Frame.PostCommandBuffer;
+          }
+
+          // raytracing, signals graphics timeline for staging ring space copied by frame and trace timeline for post processing
+          UINT64 FrameGraphicsValue = ++GraphicsTimelineValue;
+          VkSemaphore TraceSignalSemaphores[] {GraphicsTimeline, TraceTimeline};
+          UINT64 TraceSignalValues[] {FrameGraphicsValue, FramePostValue};
+          UINT32 TraceSignalCount = IsHeadless() ? 1U : 2U;
+
+          VkTimelineSemaphoreSubmitInfo TraceTimelineSubmitInfo
+          {
+            .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+            .pNext = nullptr,
+            .waitSemaphoreValueCount = (UINT32)TraceWaits.Values.size(),
+            .pWaitSemaphoreValues = TraceWaits.Values.data(),
+            .signalSemaphoreValueCount = TraceSignalCount,
+            .pSignalSemaphoreValues = TraceSignalValues,
           };
-          VkStridedDeviceAddressRegionKHR HitRegion
+
+          VkSubmitInfo TraceSubmitInfo
           {
-            .deviceAddress = Scene->SBTStorageBuffer.GetDeviceAddress() + Scene->SBTAlignedGroupSize * 2,
-            .stride = Scene->SBTAlignedGroupSize,
-            .size = Scene->SBTAlignedGroupSize * Scene->HitShaderGroupCount,
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .pNext = &TraceTimelineSubmitInfo,
+            .waitSemaphoreCount = (UINT32)TraceWaits.Semaphores.size(),
+            .pWaitSemaphores = TraceWaits.Semaphores.data(),
+            .pWaitDstStageMask = TraceWaits.Stages.data(),
+            .commandBufferCount = CommandBufferCount,
+            .pCommandBuffers = CommandBuffers,
+            .signalSemaphoreCount = TraceSignalCount,
+            .pSignalSemaphores = TraceSignalSemaphores,
           };
 
-          VkStridedDeviceAddressRegionKHR CallableRegion {};
+          // headless frame consists of raytracing only, so its submission signals frame fence
+          utils::AssertResult(vkQueueSubmit(GraphicsQueue, 1, &TraceSubmitInfo, IsHeadless() ? Frame.InFlightFence : VK_NULL_HANDLE), "can't submit raytracing command buffer");
+          TraceWaits.Clear();
 
-          vkCmdTraceRaysKHR
-          (
-            GraphicsCommandBuffer,
-            &RayGenRegion,
-            &MissRegion,
-            &HitRegion,
-            &CallableRegion,
-            SwapchainImageExtent.width, SwapchainImageExtent.height, 1
-          );
+          // vertex writes staged by scene update are released after frame copies them
+          StagingRing.Commit(GraphicsTimeline, FrameGraphicsValue);
+
+          // requested captures copy target after raytracing - next frame raytracing waits for copy on device only
+          ReadbackRing.Submit(TargetImage, SwapchainImageExtent, CollectionFrameCount);
+
+          if (IsHeadless())
+          {
+            Frame.SubmittedFrame = CurrentFrame + 1;
+            Frame.InputTime = LatencyTimer != nullptr ? LatencyTimer->GetGlobalTime() : NAN;
+            CurrentFrame++;
+            RetireRecordedBuffers();
+            return;
+          }
 
-          VkMemoryBarrier MemoryBarrier
+          // post processing on compute queue
+          VkTimelineSemaphoreSubmitInfo PostTimelineSubmitInfo
           {
-            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
             .pNext = nullptr,
-            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
-            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+            .waitSemaphoreValueCount = 1,
+            .pWaitSemaphoreValues = &FramePostValue,
+            .signalSemaphoreValueCount = 1,
+            .pSignalSemaphoreValues = &FramePostValue,
           };
 
-          /* 'end raytracing subpass' */
-          vkCmdPipelineBarrier(GraphicsCommandBuffer, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1, &MemoryBarrier, 0, nullptr, 0, nullptr);
-
-          // Drawing image to target
-          VkClearValue ClearValue { 0.0f, 1.0f, 0.0f, 1.0f };
+          VkPipelineStageFlags PostWaitStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
 
-          VkRenderPassBeginInfo BeginInfo
+          VkSubmitInfo PostSubmitInfo
           {
-            /* VkStructureType     */ .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-            /* const void*         */ .pNext = nullptr,
-            /* VkRenderPass        */ .renderPass = PresentRenderPass,
-            /* VkFramebuffer       */ .framebuffer = Framebuffers[ImageIndex],
-            /* VkRect2D            */ .renderArea = { 0, 0, SwapchainImageExtent.width, SwapchainImageExtent.height },
-            /* uint32_t            */ .clearValueCount = 1,
-            /* const VkClearValue* */ .pClearValues = &ClearValue,
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .pNext = &PostTimelineSubmitInfo,
+            .waitSemaphoreCount = 1,
+            .pWaitSemaphores = &TraceTimeline,
+            .pWaitDstStageMask = &PostWaitStage,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &Frame.ComputeCommandBuffer,
+            .signalSemaphoreCount = 1,
+            .pSignalSemaphores = &PostTimeline,
           };
-          vkCmdBeginRenderPass(GraphicsCommandBuffer, &BeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-          vkCmdBindPipeline(GraphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, PresentPipeline);
+          utils::AssertResult(vkQueueSubmit(ComputeQueue, 1, &PostSubmitInfo, VK_NULL_HANDLE), "can't submit post processing command buffer");
+          PostValue = Frame.PostValue = FramePostValue;
+          PostInputTimes[PostImageIndex] = LatencyTimer != nullptr ? LatencyTimer->GetGlobalTime() : NAN;
+          PresentedPostValue = PresentValue;
 
-          VkViewport Viewport { 0, 0, (FLOAT)SwapchainImageExtent.width, (FLOAT)SwapchainImageExtent.height, 0.0f, 1.0f };
-          vkCmdSetViewport(GraphicsCommandBuffer, 0, 1, &Viewport);
-          VkRect2D Scissor { {0, 0}, SwapchainImageExtent };
-          vkCmdSetScissor(GraphicsCommandBuffer, 0, 1, &Scissor);
-          vkCmdBindDescriptorSets(GraphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, PresentPipelineLayout, 0, 1, &PresentDescriptorSet, 0, nullptr);
-          vkCmdDraw(GraphicsCommandBuffer, 4, 1, 0, 0);
+          // presentation of post processed image
+          VkCommandBuffer PresentCommandBuffers[2] {Frame.PresentCommandBuffer, Commands.PresentCommandBuffer};
+          UINT32 PresentCommandBufferCount = IsPresentAcquireRecorded ? 2 : 1;
 
-          vkCmdEndRenderPass(GraphicsCommandBuffer);
+          VkSemaphore waitSemaphores[] {Frame.ImageAvailableSemaphore, PostTimeline};
+          UINT64 WaitValues[] {0, PresentValue};
+          VkPipelineStageFlags Flags[] {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT};
+          VkSemaphore signalSemaphores[] {Frame.RenderFinishedSemaphore};
 
-          vkEndCommandBuffer(GraphicsCommandBuffer);
-
-          // submit commands to queue
-          VkSemaphore waitSemaphores[] {ImageAvailableSemaphore};
-          VkPipelineStageFlags Flags[] {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-          VkSemaphore signalSemaphores[] {RenderFinishedSemaphore};
+          VkTimelineSemaphoreSubmitInfo TimelineSubmitInfo
+          {
+            .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+            .pNext = nullptr,
+            .waitSemaphoreValueCount = (UINT32)std::size(WaitValues),
+            .pWaitSemaphoreValues = WaitValues,
+            .signalSemaphoreValueCount = 0,
+            .pSignalSemaphoreValues = nullptr,
+          };
 
           VkSubmitInfo GraphicsSubmitInfo
           {
             .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-            .pNext = nullptr,
+            .pNext = &TimelineSubmitInfo,
             .waitSemaphoreCount = (UINT32)std::size(waitSemaphores),
             .pWaitSemaphores = waitSemaphores,
             .pWaitDstStageMask = Flags,
-            .commandBufferCount = 1,
-            .pCommandBuffers = &GraphicsCommandBuffer,
+            .commandBufferCount = PresentCommandBufferCount,
+            .pCommandBuffers = PresentCommandBuffers + 2 - PresentCommandBufferCount,
             .signalSemaphoreCount = (UINT32)std::size(signalSemaphores),
             .pSignalSemaphores = signalSemaphores,
           };
 
-          utils::AssertResult(vkQueueSubmit(GraphicsQueue, 1, &GraphicsSubmitInfo, InFlightFence), "can't submit graphics command buffer");
+          utils::AssertResult(vkQueueSubmit(GraphicsQueue, 1, &GraphicsSubmitInfo, Frame.InFlightFence), "can't submit graphics command buffer");
+          Frame.SubmittedFrame = CurrentFrame + 1;
+
+          // frame presents previous frame post image, so latency is measured for input of frame, which rendered it (repeated image isn't sampled twice)
+          Frame.InputTime = PostInputTimes[PresentImageIndex];
+          PostInputTimes[PresentImageIndex] = NAN;
 
           VkSwapchainKHR swapchains[] {Swapchain};
           VkPresentInfoKHR presentInfo
@@ -1440,17 +2553,21 @@ namespace vrt
             .pResults = nullptr,
           };
 
-          vkQueuePresentKHR(PresentQueue, &presentInfo);
+          VkResult PresentResult = vkQueuePresentKHR(PresentQueue, &presentInfo);
+          if (PresentResult == VK_SUBOPTIMAL_KHR || PresentResult == VK_ERROR_OUT_OF_DATE_KHR)
+            IsSwapchainOutdated = TRUE;
 
           CurrentFrame++;
+          RetireRecordedBuffers();
         } /* Render */
 
+        /* Released resources retiring function. Resources are destroyed after device stops using them. */
         VOID FlushFree( VOID )
         {
-          manager<scene, std::string>::FlushFree();
-          manager<model>::FlushFree();
-          manager<primitive>::FlushFree();
-          manager<material, std::string>::FlushFree();
+          RetireFree<scene, std::string>();
+          RetireFree<model, UINT32>();
+          RetireFree<primitive, UINT32>();
+          RetireFree<material, std::string>();
         } /* FlushFree */
 
         VOID Close( VOID )
@@ -1459,22 +2576,47 @@ namespace vrt
 
           vkDeviceWaitIdle(Device);
 
+          // resource destructors release resources they use, so flush until nothing is left
           FlushFree();
+          while (!RetireQueue.empty())
+          {
+            FlushRetired();
+            FlushFree();
+          }
 
-          // destroy presentation data
+          // destroy presentation data (headless kernel has target only)
           Destroy(TargetImage);
-          Destroy(PresentBuffer);
           vkDestroySampler(Device, TargetImageSampler, nullptr);
-          vkDestroyRenderPass(Device, PresentRenderPass, nullptr);
-          vkDestroyDescriptorSetLayout(Device, PresentDescriptorSetLayout, nullptr);
-          vkDestroyDescriptorPool(Device, PresentDescriptorPool, nullptr);
-          vkDestroyPipelineLayout(Device, PresentPipelineLayout, nullptr);
-          vkDestroyPipeline(Device, PresentPipeline, nullptr);
-          vkDestroyFence(Device, InFlightFence, nullptr);
-          vkDestroySemaphore(Device, ImageAvailableSemaphore, nullptr);
-          vkDestroySemaphore(Device, RenderFinishedSemaphore, nullptr);
-
-          VkCommandPool CommandPools[] {GraphicsCommandPool, TransferCommandPool, ComputeCommandPool};
+          if (!IsHeadless())
+          {
+            DestroyPostImages();
+            vkDestroyPipeline(Device, PostPipeline, nullptr);
+            vkDestroyRenderPass(Device, PresentRenderPass, nullptr);
+            vkDestroyDescriptorSetLayout(Device, PresentDescriptorSetLayout, nullptr);
+            vkDestroyDescriptorPool(Device, PresentDescriptorPool, nullptr);
+            vkDestroyPipelineLayout(Device, PresentPipelineLayout, nullptr);
+            vkDestroyPipeline(Device, PresentPipeline, nullptr);
+          }
+          DestroyFrameCommands();
+          RecordingScheduler.Close();
+          ReadbackRing.Close();
+          FrameEncoder.Close();
+          for (frame &Frame : Frames)
+          {
+            vkDestroyFence(Device, Frame.InFlightFence, nullptr);
+            vkDestroySemaphore(Device, Frame.ImageAvailableSemaphore, nullptr);
+            vkDestroySemaphore(Device, Frame.RenderFinishedSemaphore, nullptr);
+          }
+
+          ScratchArena.Close();
+          GeometryPool.Close();
+          UniformRing.Close();
+          StagingRing.Close();
+          CloseTimelines();
+
+          CloseThreadCommandAllocators();
+
+          VkCommandPool CommandPools[] {GraphicsCommandPool, ComputeCommandPool};
           for (VkCommandPool CommandPool : CommandPools)
             vkDestroyCommandPool(Device, CommandPool, nullptr);
 
@@ -1483,9 +2625,13 @@ namespace vrt
           for (VkImageView ImageView : SwapchainImageViews)
             vkDestroyImageView(Device, ImageView, nullptr);
 
-          vkDestroySwapchainKHR(Device, Swapchain, nullptr);
+          // surface and swapchain extensions aren't loaded in headless mode
+          if (!IsHeadless())
+            vkDestroySwapchainKHR(Device, Swapchain, nullptr);
+          MemoryAllocator.Close();
           vkDestroyDevice(Device, nullptr);
-          vkDestroySurfaceKHR(Instance, Surface, nullptr);
+          if (!IsHeadless())
+            vkDestroySurfaceKHR(Instance, Surface, nullptr);
           vkDestroyDebugUtilsMessengerEXT(Instance, DebugMessenger, nullptr);
           vkDestroyInstance(Instance, nullptr);
         } /* Close */
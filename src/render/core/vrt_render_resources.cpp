@@ -15,11 +15,84 @@ namespace vrt::render::core
       Prim->Release();
   } /* model */
 
+  FLOAT model::GetBoundsArea( VOID ) const
+  {
+    if (Primitives.empty())
+      return 0;
+
+    vec3 Min = Primitives[0]->BoundsMin, Max = Primitives[0]->BoundsMax;
+    for (const primitive *Prim : Primitives)
+    {
+      Min = vec3(std::min(Min.X, Prim->BoundsMin.X), std::min(Min.Y, Prim->BoundsMin.Y), std::min(Min.Z, Prim->BoundsMin.Z));
+      Max = vec3(std::max(Max.X, Prim->BoundsMax.X), std::max(Max.Y, Prim->BoundsMax.Y), std::max(Max.Z, Prim->BoundsMax.Z));
+    }
+
+    vec3 Size = Max - Min;
+    return 2 * (Size.X * Size.Y + Size.Y * Size.Z + Size.Z * Size.X);
+  } /* GetBoundsArea */
+
+  BOOL model::IsGeometryChanged( VOID ) const
+  {
+    for (SIZE_T i = 0; i < Primitives.size(); i++)
+      if (Primitives[i]->GeometryGeneration != BuiltGeometryGenerations[i])
+        return TRUE;
+    return FALSE;
+  } /* IsGeometryChanged */
+
+  VOID primitive::EvaluateBounds( const VOID *Vertices )
+  {
+    const BYTE *Position = reinterpret_cast<const BYTE *>(Vertices) + VertexPositionComponentOffset;
+
+    BoundsMin = vec3(FLT_MAX);
+    BoundsMax = vec3(-FLT_MAX);
+    for (SIZE_T i = 0; i < VertexCount; i++, Position += VertexSize)
+    {
+      vec3 P;
+      std::memcpy(&P, Position, sizeof(vec3));
+
+      BoundsMin = vec3(std::min(BoundsMin.X, P.X), std::min(BoundsMin.Y, P.Y), std::min(BoundsMin.Z, P.Z));
+      BoundsMax = vec3(std::max(BoundsMax.X, P.X), std::max(BoundsMax.Y, P.Y), std::max(BoundsMax.Z, P.Z));
+    }
+  } /* EvaluateBounds */
+
+  VOID primitive::InvalidateGeometry( const vec3 &NewBoundsMin, const vec3 &NewBoundsMax, VkSemaphore WriteTimeline, UINT64 WriteValue )
+  {
+    utils::Assert(!IsStatic, "geometry of static model can't be changed");
+
+    BoundsMin = NewBoundsMin;
+    BoundsMax = NewBoundsMax;
+    GeometryGeneration++;
+    Kernel->AddGeometryWrite(WriteTimeline, WriteValue);
+  } /* InvalidateGeometry */
+
+  VkDeviceAddress primitive::GetVertexAddress( VOID ) const
+  {
+    if (VertexRange.Page != UINT32_MAX)
+      return Kernel->GeometryPool.GetAddress(VertexRange);
+    return VertexBuffer.GetDeviceAddress();
+  } /* GetVertexAddress */
+
+  VkDeviceAddress primitive::GetIndexAddress( VOID ) const
+  {
+    if (IndexCount == 0)
+      return 0;
+    if (IndexRange.Page != UINT32_MAX)
+      return Kernel->GeometryPool.GetAddress(IndexRange);
+    return IndexBuffer.GetDeviceAddress();
+  } /* GetIndexAddress */
+
   primitive::~primitive( VOID )
   {
     Material->Release();
-    Kernel->Destroy(VertexBuffer);
-    if (IndexCount != 0)
+
+    if (VertexRange.Page != UINT32_MAX)
+      Kernel->GeometryPool.Free(VertexRange);
+    else
+      Kernel->Destroy(VertexBuffer);
+
+    if (IndexRange.Page != UINT32_MAX)
+      Kernel->GeometryPool.Free(IndexRange);
+    else if (IndexCount != 0)
       Kernel->Destroy(IndexBuffer);
   } /* ~primitive */
 
@@ -37,7 +110,6 @@ namespace vrt::render::core
     vkDestroyDescriptorSetLayout(Kernel->Device, DescriptorSetLayout, nullptr);
 
     Kernel->Destroy(LightStorageBuffer);
-    Kernel->Destroy(GlobalBuffer);
     Kernel->Destroy(InstanceBuffer);
     Kernel->Destroy(TLASStorageBuffer);
     Kernel->Destroy(SBTStorageBuffer);
@@ -17,11 +17,14 @@ namespace vrt::render::core
       /* uint32_t        */ .apiVersion = VK_API_VERSION_1_3,
     };
 
-    // get presentation-required instance extensions from windower
-    UINT32 RequiredInstanceExtensionCount = 0, EnabledInstanceExtensionCount = static_cast<UINT32>(EnabledInstanceExtensions.size());
-    SDL_Vulkan_GetInstanceExtensions(Window, &RequiredInstanceExtensionCount, nullptr);
-    EnabledInstanceExtensions.resize(EnabledInstanceExtensions.size() + RequiredInstanceExtensionCount);
-    SDL_Vulkan_GetInstanceExtensions(Window, &RequiredInstanceExtensionCount, &EnabledInstanceExtensions[EnabledInstanceExtensionCount]);
+    // get presentation-required instance extensions from windower (headless instance doesn't need them)
+    if (!IsHeadless())
+    {
+      UINT32 RequiredInstanceExtensionCount = 0, EnabledInstanceExtensionCount = static_cast<UINT32>(EnabledInstanceExtensions.size());
+      SDL_Vulkan_GetInstanceExtensions(Window, &RequiredInstanceExtensionCount, nullptr);
+      EnabledInstanceExtensions.resize(EnabledInstanceExtensions.size() + RequiredInstanceExtensionCount);
+      SDL_Vulkan_GetInstanceExtensions(Window, &RequiredInstanceExtensionCount, &EnabledInstanceExtensions[EnabledInstanceExtensionCount]);
+    }
 
     VkDebugUtilsMessengerCreateInfoEXT MessengerCreateInfo = GetDebugMessengerCreateInfo();
 
@@ -64,7 +67,6 @@ namespace vrt::render::core
     } Descriptions[]
     {
       {QueueFamilies.Graphics, GraphicsCommandPool},
-      {QueueFamilies.Transfer, TransferCommandPool},
       {QueueFamilies.Compute, ComputeCommandPool}
     };
 
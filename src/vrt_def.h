@@ -4,11 +4,18 @@
 
 #define _CRT_SECURE_NO_WARNINGS
 
+// MSVC debug heap is used for leak checking on Windows only
+#ifdef _MSC_VER
 #define _CRTDBG_MAP_ALLOC
+#endif
 #include <cstdlib>
+#include <cstring>
+#include <cfloat>
+#ifdef _MSC_VER
 #include <crtdbg.h>
+#endif
 
-#ifdef _DEBUG
+#if defined(_MSC_VER) && defined(_DEBUG)
     #define DBG_NEW new ( _NORMAL_BLOCK , __FILE__ , __LINE__ )
     // Replace _NORMAL_BLOCK with _CLIENT_BLOCK if you want the
     // allocations to be of _CLIENT_BLOCK type
@@ -24,12 +31,21 @@
 #include <chrono>
 #include <optional>
 #include <vector>
+#include <deque>
 #include <array>
 #include <map>
 #include <set>
 #include <algorithm>
+#include <bit>
 #include <filesystem>
-
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+
+// libraries are linked by pragmas in MSVC build only, other toolchains pass them to linker
+#ifdef _MSC_VER
 #pragma warning(disable : 26812)
 
 #pragma warning(push)
@@ -40,6 +56,7 @@
 
 #pragma comment(lib, "volk.lib")
 #pragma comment(lib, "dxcompiler.lib")
+#endif
 
 #define VK_NO_PROTOTYPES
 #include <vulkan/vulkan.h>
@@ -50,7 +67,9 @@
 #include <SDL_vulkan.h>
 #include <SDL_image.h>
 #include <SDL_test.h>
+#ifdef _MSC_VER
 #pragma warning(pop)
+#endif
 
 namespace vrt
 {
@@ -4,10 +4,12 @@ std::string vrt::unit_register_table::MainId;
 
 int main( int argc, char **argv )
 {
+#ifdef _MSC_VER
   if constexpr (vrt::IS_DEBUG)
     _CrtSetDbgFlag ( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF );
+#endif
 
-  vrt::system System;
+  vrt::system System({const_cast<const vrt::CHAR **>(argv), static_cast<vrt::SIZE_T>(argc)});
 
   System.Run();
   return 0;
@@ -199,13 +199,43 @@ namespace vrt
         FirstToDelete = stg;
       } /* Free */
 
-      VOID FlushFree( VOID )
+      /* list of freed objects, which destruction is postponed */
+      struct free_list
+      {
+        storage *First = nullptr;
+
+        BOOL IsEmpty( VOID ) const
+        {
+          return First == nullptr;
+        } /* IsEmpty */
+      }; /* free_list */
+
+      /* Freed objects detaching function. Detached objects stay alive (and their storage isn't reused) until list is flushed.
+       * ARGUMENTS: None.
+       * RETURNS:
+       *   (free_list) detached objects.
+       */
+      free_list DetachFree( VOID )
+      {
+        free_list List {FirstToDelete};
+
+        FirstToDelete = nullptr;
+        return List;
+      } /* DetachFree */
+
+      /* Detached objects destroying function.
+       * ARGUMENTS:
+       *   - list of objects detached by DetachFree:
+       *       free_list List;
+       * RETURNS: None.
+       */
+      VOID FlushFree( free_list List )
       {
-        if (FirstToDelete == nullptr)
+        if (List.First == nullptr)
           return;
 
         storage *last = nullptr;
-        for (storage *first = FirstToDelete; first != nullptr; first = first->Next)
+        for (storage *first = List.First; first != nullptr; first = first->Next)
         {
           OnFree(first->Data);
 
@@ -216,8 +246,12 @@ namespace vrt
         last->Next = FirstFree;
         if (FirstFree != nullptr)
           FirstFree->Prev = last;
-        FirstFree = FirstToDelete;
-        FirstToDelete = nullptr;
+        FirstFree = List.First;
+      } /* FlushFree */
+
+      VOID FlushFree( VOID )
+      {
+        FlushFree(DetachFree());
       } /* FlushFree */
 
       virtual VOID OnFree( object_type &Object )
@@ -150,8 +150,38 @@ namespace vrt
     struct { INT Width, Height; } OldWindowSize = {30, 30};
 
   public:
+    /* Headless rendering options (from '--headless [--width W] [--height H] [--frames N] [--output FILE]' arguments) */
+    struct headless_options
+    {
+      BOOL IsEnabled = FALSE;                 // is rendering done without window
+      UINT32 Width = 800, Height = 600;       // target image extent
+      UINT32 FrameCount = 256;                // number of accumulated frames
+      std::string OutputFileName = "out.png"; // accumulated image file
+    }; /* headless_options */
+
+    /* Frame sequence export options (from '--export PREFIX [--format png|pfm] [--turntable K | --path FILE]' arguments).
+     * Export is headless, '--frames N' frames are accumulated per camera keyframe.
+     */
+    struct export_options
+    {
+      std::string Prefix;                  // output files prefix (empty - no export)
+      std::string Format = "png";          // output files format: 'png' - tone mapped, 'pfm' - linear floats
+      UINT32 TurntableKeyframeCount = 36;  // number of keyframes on circle around scene (if there is no path)
+      std::string PathFileName;            // camera path file, line per keyframe: 'x y z tx ty tz' - location and target
+    }; /* export_options */
+
+    /* Camera keyframe */
+    struct camera_keyframe
+    {
+      vec3 Location; // camera location
+      vec3 Target;   // point camera looks at
+    }; /* camera_keyframe */
+
     std::span<const CHAR *> ConsoleArguments {};
+    headless_options Headless {};
+    export_options Export {};
     BOOL IsFullscreen = FALSE;
+    UINT32 ScreenshotCount = 0;
     utils::timer Timer {};
     utils::input Input {};
     render::engine Render {};
@@ -177,15 +207,166 @@ namespace vrt
       IsFullscreen = !IsFullscreen;
     } /* SwitchFullscreen */
 
+    VOID SwitchPresentMode( VOID )
+    {
+      static const VkPresentModeKHR PresentModes[] {VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR};
+
+      render::engine::present_policy Policy = Render.PresentPolicy;
+      SIZE_T Index = std::find(std::begin(PresentModes), std::end(PresentModes), Policy.PresentMode) - std::begin(PresentModes);
+
+      Policy.PresentMode = PresentModes[(Index + 1) % std::size(PresentModes)];
+      Render.SetPresentPolicy(Policy);
+    } /* SwitchPresentMode */
+
+    VOID ParseArguments( VOID )
+    {
+      for (SIZE_T i = 1; i < ConsoleArguments.size(); i++)
+      {
+        std::string_view Argument = ConsoleArguments[i];
+        BOOL HasValue = i + 1 < ConsoleArguments.size();
+
+        if (Argument == "--headless")
+          Headless.IsEnabled = TRUE;
+        else if (Argument == "--width" && HasValue)
+          Headless.Width = (UINT32)std::max(std::atoi(ConsoleArguments[++i]), 1);
+        else if (Argument == "--height" && HasValue)
+          Headless.Height = (UINT32)std::max(std::atoi(ConsoleArguments[++i]), 1);
+        else if (Argument == "--frames" && HasValue)
+          Headless.FrameCount = (UINT32)std::max(std::atoi(ConsoleArguments[++i]), 1);
+        else if (Argument == "--output" && HasValue)
+          Headless.OutputFileName = ConsoleArguments[++i];
+        else if (Argument == "--export" && HasValue)
+        {
+          Export.Prefix = ConsoleArguments[++i];
+          Headless.IsEnabled = TRUE;
+        }
+        else if (Argument == "--format" && HasValue)
+        {
+          // readback chooses encoding by extension, so unknown format would be saved as PNG under its name
+          Export.Format = ConsoleArguments[++i];
+          utils::Assert(Export.Format == "png" || Export.Format == "pfm", std::format("unsupported export format '{}', 'png' or 'pfm' is expected", Export.Format));
+        }
+        else if (Argument == "--turntable" && HasValue)
+          Export.TurntableKeyframeCount = (UINT32)std::max(std::atoi(ConsoleArguments[++i]), 1);
+        else if (Argument == "--path" && HasValue)
+          Export.PathFileName = ConsoleArguments[++i];
+      }
+    } /* ParseArguments */
+
+    /* Export camera keyframes getting function. Keyframes are loaded from path file or placed on circle around scene. */
+    std::vector<camera_keyframe> GetExportKeyframes( VOID )
+    {
+      std::vector<camera_keyframe> Keyframes;
+
+      if (!Export.PathFileName.empty())
+      {
+        std::FILE *File = std::fopen(Export.PathFileName.c_str(), "r");
+
+        if (File == nullptr)
+        {
+          std::cerr << std::format("system: can't open camera path '{}'.\n", Export.PathFileName);
+          return Keyframes;
+        }
+
+        camera_keyframe Keyframe;
+        while (std::fscanf(File, "%f %f %f %f %f %f", &Keyframe.Location.X, &Keyframe.Location.Y, &Keyframe.Location.Z, &Keyframe.Target.X, &Keyframe.Target.Y, &Keyframe.Target.Z) == 6)
+          Keyframes.push_back(Keyframe);
+
+        std::fclose(File);
+        return Keyframes;
+      }
+
+      // turntable around scene center
+      const FLOAT Radius = 6.0f, Height = 2.0f;
+      for (UINT32 i = 0; i < Export.TurntableKeyframeCount; i++)
+      {
+        FLOAT Angle = 2.0f * static_cast<FLOAT>(mth::PI) * i / Export.TurntableKeyframeCount;
+
+        Keyframes.push_back(camera_keyframe {vec3(std::cos(Angle) * Radius, Height, std::sin(Angle) * Radius), vec3(0, 1, 0)});
+      }
+
+      return Keyframes;
+    } /* GetExportKeyframes */
+
     system( std::span<const CHAR *> ConsoleArguments = {} ) : ConsoleArguments(ConsoleArguments)
     {
-      SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS);
+      ParseArguments();
+
+      // headless machines have no video device
+      SDL_Init(Headless.IsEnabled ? SDL_INIT_EVENTS : SDL_INIT_VIDEO | SDL_INIT_EVENTS);
       IMG_Init(IMG_INIT_JPG | IMG_INIT_PNG);
-      Window = SDL_CreateWindow("rtt", 30, 30, 800, 600, SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
 
-      Render.Initialize(Window);
+      if (Headless.IsEnabled)
+        Render.Initialize(nullptr, {Headless.Width, Headless.Height});
+      else
+      {
+        Window = SDL_CreateWindow("rtt", 30, 30, 800, 600, SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
+        Render.Initialize(Window);
+      }
+      Render.LatencyTimer = &Timer;
     } /* system */
 
+    /* Headless rendering function. Scene is rendered given number of frames, accumulated result is saved to output file. */
+    VOID RunHeadless( VOID )
+    {
+      Render.DoPresentCollection = TRUE;
+      FLOAT StartTime = Timer.GetCurrentTime();
+
+      for (UINT32 i = 0; i < Headless.FrameCount; i++)
+      {
+        Timer.Response();
+        Input.Response();
+        Scene->Response();
+        Render.Render();
+      }
+
+      // saving waits for all frames, so time covers whole rendering
+      if (!Render.SaveTarget(Headless.OutputFileName))
+        std::cerr << std::format("system: can't save '{}'.\n", Headless.OutputFileName);
+      FLOAT Duration = Timer.GetCurrentTime() - StartTime;
+      std::cout << std::format("system: {} frames rendered in {:.2f} s ({:.1f} FPS).\n", Headless.FrameCount, Duration, Headless.FrameCount / Duration);
+    } /* RunHeadless */
+
+    /* Frame sequence export function. Every keyframe is accumulated for given number of frames and captured.
+     * Captures are saved by encoder threads - if they fall behind, keyframe is accumulated longer instead of waiting for them.
+     */
+    VOID RunExport( VOID )
+    {
+      std::vector<camera_keyframe> Keyframes = GetExportKeyframes();
+
+      Render.DoPresentCollection = TRUE;
+      FLOAT StartTime = Timer.GetCurrentTime();
+      SIZE_T FrameCount = 0;
+      UINT32 KeyframeFrameCount = 0;
+
+      for (SIZE_T KeyframeIndex = 0; KeyframeIndex < Keyframes.size(); FrameCount++)
+      {
+        if (KeyframeFrameCount == 0)
+        {
+          Render.Scene->Camera.Set(Keyframes[KeyframeIndex].Location, Keyframes[KeyframeIndex].Target - Keyframes[KeyframeIndex].Location);
+          Render.ResetCollection();
+        }
+
+        Timer.Response();
+
+        // capture is made after raytracing of this frame
+        BOOL DoCapture = ++KeyframeFrameCount >= Headless.FrameCount && Render.IsCaptureAvailable();
+        if (DoCapture)
+          Render.CaptureTarget(std::format("{}_{:04}.{}", Export.Prefix, KeyframeIndex, Export.Format));
+
+        Render.Render();
+
+        if (DoCapture)
+        {
+          KeyframeIndex++;
+          KeyframeFrameCount = 0;
+        }
+      }
+
+      FLOAT Duration = Timer.GetCurrentTime() - StartTime;
+      std::cout << std::format("system: {} keyframes ({} frames) rendered in {:.2f} s, saving is finished on exit.\n", Keyframes.size(), FrameCount, Duration);
+    } /* RunExport */
+
     VOID Run( VOID )
     {
       BOOL isRunning = TRUE;
@@ -194,10 +375,23 @@ namespace vrt
 
       Scene->AddUnit(unit_register_table::MainId);
 
+      if (Headless.IsEnabled)
+      {
+        if (Export.Prefix.empty())
+          RunHeadless();
+        else
+          RunExport();
+        isRunning = FALSE;
+      }
+
       while (isRunning)
       {
         SDL_Event event;
 
+        // minimized window has nothing to render to - thread sleeps until some event (e.g. restoring) comes instead of spinning
+        if (Render.IsPaused())
+          SDL_WaitEvent(nullptr);
+
         while (SDL_PollEvent(&event))
         {
           switch (event.type)
@@ -217,11 +411,22 @@ namespace vrt
             case SDL_SCANCODE_F11:
               SwitchFullscreen();
               break;
+
+            case SDL_SCANCODE_F10:
+              SwitchPresentMode();
+              break;
+
+            // target is saved by readback worker, frame isn't stalled
+            case SDL_SCANCODE_F12:
+              Render.CaptureTarget(std::format("screenshot_{}.png", ScreenshotCount++));
+              break;
             }
             break;
 
           case SDL_WINDOWEVENT:
-            Render.Resize();
+            // all events of frame are coalesced into one request
+            if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+              Render.RequestResize();
             break;
           }
         }
@@ -238,7 +443,8 @@ namespace vrt
     ~system( VOID )
     {
       Render.Close();
-      SDL_DestroyWindow(Window);
+      if (Window != nullptr)
+        SDL_DestroyWindow(Window);
 
       IMG_Quit();
       SDL_Quit();
@@ -96,7 +96,8 @@ namespace vrt
         if (Width == 0 || Height == 0)
           return FALSE;
 
-        SDL_Surface *surface = SDL_CreateRGBSurfaceFrom(Pixels.data(), static_cast<INT>(Width), static_cast<INT>(Height), 1, static_cast<INT>(Width * sizeof(UINT32)), 0, 0, 0, 0);
+        // pixels have same format as loaded ones
+        SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormatFrom(Pixels.data(), static_cast<INT>(Width), static_cast<INT>(Height), 32, static_cast<INT>(Width * sizeof(UINT32)), SDL_PIXELFORMAT_ABGR8888);
 
         if (surface == nullptr)
           return FALSE;
@@ -130,6 +131,10 @@ namespace vrt
       FLOAT FPS = NAN;
       FLOAT FPS_TimeAverage = NAN;
 
+      FLOAT Latency_SampleSum = 0.0f;
+      UINT32 Latency_SampleCounter = 0;
+      FLOAT Latency = NAN; // average input to present latency (in seconds) during last FPS update period
+
     public:
       FLOAT FPS_UpdateDuration = 3.0f;
 
@@ -195,15 +200,30 @@ namespace vrt
           FPS = FPS_FrameCounter / fpsLastUpdateElapsedTime;
           FPS_LastUpdateTime = CurrentTime;
           FPS_FrameCounter = 0;
+
+          if (Latency_SampleCounter != 0)
+            Latency = Latency_SampleSum / Latency_SampleCounter;
+          Latency_SampleSum = 0.0f;
+          Latency_SampleCounter = 0;
         }
         FPS_TimeAverage = TotalFrameCount / GlobalTime; // get average framerate
       } /* response */
 
 
+      /* Latency sample adding function. InputTime - global time of frame, which input presented frame is rendered with. */
+      VOID ResponseLatency( FLOAT InputTime )
+      {
+        Latency_SampleSum += GetCurrentTime() - InputTime;
+        Latency_SampleCounter++;
+      } /* ResponseLatency */
+
+
       inline FLOAT GetTime( VOID )            const { return Time;            } /* getTime */
       inline FLOAT GetDeltaTime( VOID )       const { return DeltaTime;       } /* getDeltaTime */
       inline FLOAT GetGlobalTime( VOID )      const { return GlobalTime;      } /* getGlobalTime */
       inline FLOAT GetGlobalDeltaTime( VOID ) const { return GlobalDeltaTime; } /* getGlobalDeltaTime */
+      inline FLOAT GetFPS( VOID )             const { return FPS;             } /* getFPS */
+      inline FLOAT GetLatency( VOID )         const { return Latency;         } /* getLatency */
 
       inline BOOL IsPaused( VOID ) const { return Paused; } /* isPaused */
     }; /* timer */